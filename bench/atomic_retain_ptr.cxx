@@ -0,0 +1,81 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+#include <mutex>
+
+namespace {
+
+struct table : sg14::atomic_reference_count<table> {
+  explicit table (std::size_t version) : version { version } { }
+  std::size_t version;
+};
+
+struct shared_table { std::size_t version; };
+
+using table_ptr = sg14::retain_ptr<table>;
+
+struct locked_slot {
+  table_ptr load () const {
+    std::lock_guard<std::mutex> lock { this->mutex };
+    return this->ptr;
+  }
+
+  void store (table_ptr ptr) {
+    std::lock_guard<std::mutex> lock { this->mutex };
+    this->ptr.swap(ptr);
+  }
+
+private:
+  mutable std::mutex mutex;
+  table_ptr ptr;
+};
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+struct std_slot {
+  std::shared_ptr<shared_table> load () const { return this->ptr.load(); }
+  void store (std::shared_ptr<shared_table> p) { this->ptr.store(std::move(p)); }
+private:
+  std::atomic<std::shared_ptr<shared_table>> ptr;
+};
+#else
+struct std_slot {
+  std::shared_ptr<shared_table> load () const { return std::atomic_load(&this->ptr); }
+  void store (std::shared_ptr<shared_table> p) { std::atomic_store(&this->ptr, std::move(p)); }
+private:
+  std::shared_ptr<shared_table> ptr;
+};
+#endif
+
+constexpr std::size_t writer_period = 1024;
+
+/* Every thread reads the slot; thread 0 additionally publishes a new table
+ * every writer_period reads so readers contend with an active writer.
+ */
+template <class Slot, class Make>
+void contend (char const* name, std::size_t threads, std::size_t count, Make make) {
+  Slot slot;
+  slot.store(make(0));
+  auto elapsed = bench::run_threads(threads, [&] (std::size_t idx) {
+    for (std::size_t i = 0; i < count; ++i) {
+      if (idx == 0 and i % writer_period == 0) { slot.store(make(i)); }
+      auto ptr = slot.load();
+      bench::do_not_optimize(ptr->version);
+    }
+  });
+  bench::report("atomic_retain_ptr", name, threads, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 20);
+  auto make_table = [] (std::size_t v) { return table_ptr { new table { v } }; };
+  auto make_shared = [] (std::size_t v) {
+    return std::make_shared<shared_table>(shared_table { v });
+  };
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    contend<sg14::atomic_retain_ptr<table>>("atomic_retain_ptr", threads, count, make_table);
+    contend<locked_slot>("mutex + retain_ptr", threads, count, make_table);
+    contend<std_slot>("atomic<shared_ptr>", threads, count, make_shared);
+  }
+}
@@ -0,0 +1,327 @@
+#ifndef SG14_BENCH_HPP
+#define SG14_BENCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace bench {
+
+using clock = std::chrono::steady_clock;
+
+template <class T>
+inline void do_not_optimize (T const& value) noexcept {
+#if defined(__GNUC__)
+  asm volatile ("" : : "r,m"(value) : "memory");
+#else
+  static_cast<void>(*static_cast<T const volatile*>(&value));
+#endif
+}
+
+/* Iteration counts may be scaled from the command line so the same binary
+ * can be used for quick smoke runs and for long measurements.
+ */
+inline std::size_t iterations (int argc, char** argv, std::size_t fallback) {
+  if (argc < 2) { return fallback; }
+  auto scale = std::strtod(argv[1], nullptr);
+  return scale > 0 ? static_cast<std::size_t>(fallback * scale) : fallback;
+}
+
+inline std::size_t max_threads () {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/* Runs body(index) on `threads` threads that start together and returns the
+ * elapsed wall time in nanoseconds. started() runs once every thread is
+ * waiting at the start line, just before they are released.
+ */
+template <class F, class S>
+double run_threads (std::size_t threads, F body, S started) {
+  std::atomic<std::size_t> ready { 0 };
+  std::atomic<bool> go { false };
+  std::vector<std::thread> pool;
+  for (std::size_t idx = 0; idx < threads; ++idx) {
+    pool.emplace_back([&, idx] {
+      ++ready;
+      while (not go.load(std::memory_order_acquire)) { }
+      body(idx);
+    });
+  }
+  while (ready.load() != threads) { }
+  started();
+  auto start = clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& thread : pool) { thread.join(); }
+  std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+  return elapsed.count();
+}
+
+template <class F>
+double run_threads (std::size_t threads, F body) {
+  return run_threads(threads, std::move(body), [] { });
+}
+
+template <class F>
+double run (F body) {
+  auto start = clock::now();
+  body();
+  std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+  return elapsed.count();
+}
+
+inline void report (
+  char const* suite,
+  char const* name,
+  std::size_t threads,
+  std::size_t operations,
+  double nanoseconds
+) {
+  std::printf(
+    "%-24s %-40s %4zu threads %12.2f ns/op\n",
+    suite,
+    name,
+    threads,
+    nanoseconds / static_cast<double>(operations));
+}
+
+/* Prints the distribution of per-sample latencies, given in nanoseconds. */
+inline void report_percentiles (
+  char const* suite,
+  char const* name,
+  std::vector<double> samples
+) {
+  if (samples.empty()) { return; }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&] (double fraction) {
+    auto idx = static_cast<std::size_t>(fraction * static_cast<double>(samples.size() - 1));
+    return samples[idx];
+  };
+  std::printf(
+    "%-24s %-40s p50 %10.0f p99 %10.0f p99.9 %10.0f max %10.0f ns\n",
+    suite,
+    name,
+    at(0.5),
+    at(0.99),
+    at(0.999),
+    samples.back());
+}
+
+inline bool has_flag (int argc, char** argv, char const* flag) {
+  for (int idx = 1; idx < argc; ++idx) {
+    if (not std::strcmp(argv[idx], flag)) { return true; }
+  }
+  return false;
+}
+
+/* Hardware counters for the calling thread and every thread it creates once
+ * they are open; they count while enabled. Counts are negative when
+ * perf_event_open is unavailable, e.g. outside of Linux or with a
+ * restrictive perf_event_paranoid.
+ */
+struct perf_counters {
+  struct values {
+    double instructions = -1;
+    double cache_misses = -1;
+  };
+
+  perf_counters () {
+#if defined(__linux__)
+    this->fds[0] = open(PERF_COUNT_HW_INSTRUCTIONS);
+    this->fds[1] = open(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+  }
+
+  perf_counters (perf_counters const&) = delete;
+  perf_counters& operator = (perf_counters const&) = delete;
+
+  ~perf_counters () {
+#if defined(__linux__)
+    for (auto fd : this->fds) { if (fd >= 0) { ::close(fd); } }
+#endif
+  }
+
+  void start () noexcept {
+#if defined(__linux__)
+    for (auto fd : this->fds) {
+      if (fd < 0) { continue; }
+      ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  values stop () noexcept {
+    values result { };
+#if defined(__linux__)
+    double counts[2] { -1, -1 };
+    for (int idx = 0; idx < 2; ++idx) {
+      auto fd = this->fds[idx];
+      if (fd < 0) { continue; }
+      ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      std::uint64_t count = 0;
+      if (::read(fd, &count, sizeof(count)) == sizeof(count)) {
+        counts[idx] = static_cast<double>(count);
+      }
+    }
+    result.instructions = counts[0];
+    result.cache_misses = counts[1];
+#endif
+    return result;
+  }
+
+private:
+#if defined(__linux__)
+  static int open (std::uint64_t config) noexcept {
+    perf_event_attr attr { };
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+#endif
+
+  int fds[2] { -1, -1 };
+};
+
+struct measurement {
+  double nanoseconds;
+  perf_counters::values counters;
+};
+
+/* run_threads with hardware counters around it. The counters are opened
+ * before the threads are created so they inherit them, but only enabled
+ * once all of them wait at the start line, leaving out thread creation and
+ * most of the spin before the start.
+ */
+template <class F>
+measurement measure_threads (std::size_t threads, F body) {
+  perf_counters perf;
+  auto nanoseconds = run_threads(threads, std::move(body), [&] { perf.start(); });
+  return measurement { nanoseconds, perf.stop() };
+}
+
+template <class F>
+measurement measure (F body) {
+  perf_counters perf;
+  perf.start();
+  auto nanoseconds = run(std::move(body));
+  return measurement { nanoseconds, perf.stop() };
+}
+
+/* Collects measurements and prints them either as the usual table or, with
+ * --json on the command line, as one JSON document on exit so runs can be
+ * diffed across commits.
+ */
+struct recorder {
+  recorder (int argc, char** argv) : json { has_flag(argc, argv, "--json") } { }
+
+  recorder (recorder const&) = delete;
+  recorder& operator = (recorder const&) = delete;
+
+  ~recorder () {
+    if (not this->json) { return; }
+    std::printf("{\n  \"results\": [");
+    char const* separator = "\n";
+    for (auto& entry : this->entries) {
+      std::printf(
+        "%s    { \"suite\": \"%s\", \"name\": \"%s\", \"threads\": %zu, "
+        "\"operations\": %zu, \"ns_per_op\": %.3f, "
+        "\"instructions_per_op\": %s, \"cache_misses_per_op\": %s }",
+        separator,
+        escape(entry.suite).c_str(),
+        escape(entry.name).c_str(),
+        entry.threads,
+        entry.operations,
+        entry.nanoseconds / static_cast<double>(entry.operations),
+        per_op(entry.instructions, entry.operations).c_str(),
+        per_op(entry.cache_misses, entry.operations).c_str());
+      separator = ",\n";
+    }
+    std::printf("\n  ]\n}\n");
+  }
+
+  void record (
+    std::string suite,
+    std::string name,
+    std::size_t threads,
+    std::size_t operations,
+    measurement result
+  ) {
+    if (not this->json) {
+      std::printf(
+        "%-24s %-40s %4zu threads %12.2f ns/op %10s ins/op %10s misses/op\n",
+        suite.c_str(),
+        name.c_str(),
+        threads,
+        result.nanoseconds / static_cast<double>(operations),
+        per_op(result.counters.instructions, operations, "-").c_str(),
+        per_op(result.counters.cache_misses, operations, "-").c_str());
+      return;
+    }
+    this->entries.push_back(entry {
+      std::move(suite),
+      std::move(name),
+      threads,
+      operations,
+      result.nanoseconds,
+      result.counters.instructions,
+      result.counters.cache_misses
+    });
+  }
+
+private:
+  struct entry {
+    std::string suite;
+    std::string name;
+    std::size_t threads;
+    std::size_t operations;
+    double nanoseconds;
+    double instructions;
+    double cache_misses;
+  };
+
+  static std::string per_op (
+    double count,
+    std::size_t operations,
+    char const* missing = "null"
+  ) {
+    if (count < 0) { return missing; }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", count / static_cast<double>(operations));
+    return buffer;
+  }
+
+  static std::string escape (std::string const& text) {
+    std::string result;
+    for (auto c : text) {
+      if (c == '"' or c == '\\') { result += '\\'; }
+      result += c;
+    }
+    return result;
+  }
+
+  bool json;
+  std::vector<entry> entries;
+};
+
+} /* namespace bench */
+
+#endif /* SG14_BENCH_HPP */
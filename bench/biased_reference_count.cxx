@@ -0,0 +1,47 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+namespace {
+
+struct biased : sg14::biased_reference_count<biased> { };
+struct atomic : sg14::atomic_reference_count<atomic> { };
+
+template <class Ptr>
+void copy_release (char const* name, std::size_t count, Ptr const& ptr) {
+  auto elapsed = bench::run([&] {
+    for (std::size_t i = 0; i < count; ++i) {
+      auto copy = ptr;
+      bench::do_not_optimize(copy);
+    }
+  });
+  bench::report("biased_reference_count", name, 1, count, elapsed);
+}
+
+/* The object is created on the main thread, so every copy made by the
+ * worker threads goes through the shared count.
+ */
+template <class Ptr>
+void cross_thread (char const* name, std::size_t threads, std::size_t count, Ptr const& ptr) {
+  auto elapsed = bench::run_threads(threads, [&] (std::size_t) {
+    for (std::size_t i = 0; i < count; ++i) {
+      auto copy = ptr;
+      bench::do_not_optimize(copy);
+    }
+  });
+  bench::report("biased_reference_count", name, threads, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  sg14::retain_ptr<biased> biased_ptr { new biased };
+  sg14::retain_ptr<atomic> atomic_ptr { new atomic };
+
+  copy_release("owner copy/release biased", count, biased_ptr);
+  copy_release("owner copy/release atomic", count, atomic_ptr);
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    cross_thread("cross-thread copy/release biased", threads, count, biased_ptr);
+    cross_thread("cross-thread copy/release atomic", threads, count, atomic_ptr);
+  }
+}
@@ -0,0 +1,61 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+namespace {
+
+struct object : sg14::atomic_reference_count<object> { long value { 1 }; };
+
+using owner = sg14::retain_ptr<object>;
+using borrowed = sg14::borrowed_ptr<object>;
+
+constexpr int depth = 16;
+
+/* Each hop of a call chain is kept out of line, and is not a tail call,
+ * as it would be when the layers live in different translation units.
+ */
+[[gnu::noinline]] long by_value (owner ptr, int hops) {
+  if (not hops) { return ptr->value; }
+  auto value = by_value(ptr, hops - 1);
+  bench::do_not_optimize(value);
+  return value;
+}
+
+[[gnu::noinline]] long by_reference (owner const& ptr, int hops) {
+  if (not hops) { return ptr->value; }
+  auto value = by_reference(ptr, hops - 1);
+  bench::do_not_optimize(value);
+  return value;
+}
+
+[[gnu::noinline]] long by_borrow (borrowed ptr, int hops) {
+  if (not hops) { return ptr->value; }
+  auto value = by_borrow(ptr, hops - 1);
+  bench::do_not_optimize(value);
+  return value;
+}
+
+template <class F>
+void chain (bench::recorder& out, char const* name, std::size_t count, F call) {
+  auto result = bench::measure([&] {
+    long sum = 0;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+      /* Keeps the compiler from hoisting calls it has proven pure. */
+      bench::do_not_optimize(idx);
+      sum += call();
+    }
+    bench::do_not_optimize(sum);
+  });
+  out.record("borrowed_ptr", name, 1, count, result);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  bench::recorder out { argc, argv };
+  auto const count = bench::iterations(argc, argv, 1 << 20);
+  owner ptr { new object };
+
+  chain(out, "call chain, retain_ptr by value", count, [&] { return by_value(ptr, depth); });
+  chain(out, "call chain, retain_ptr const&", count, [&] { return by_reference(ptr, depth); });
+  chain(out, "call chain, borrowed_ptr", count, [&] { return by_borrow(ptr, depth); });
+}
@@ -0,0 +1,114 @@
+# Reports the generated code of the retain_ptr instantiation matrix built
+# from code_size.cxx. Run in script mode:
+#
+#   cmake -DLIBRARY=<archive> -DNM=<nm> -DOBJDUMP=<objdump>
+#         [-DOUTPUT=<file>] [-DREQUIRE_INLINE=<kind;...>] -P code_size.cmake
+#
+# The report lists the size of every sg14 function that was emitted out of
+# line, whether the copy, destroy, assign and compare entry points of each
+# counting mixin still call retain_traits::increment/decrement/release, and
+# the disassembly of copy and destroy. Kinds named in REQUIRE_INLINE fail the
+# run if they do.
+
+cmake_minimum_required(VERSION 3.8)
+
+foreach (variable LIBRARY NM OBJDUMP)
+  if (NOT ${variable})
+    message(FATAL_ERROR "code_size.cmake: ${variable} must be set")
+  endif ()
+endforeach ()
+
+function (hex_to_decimal hex result)
+  string(TOLOWER "${hex}" hex)
+  string(LENGTH "${hex}" length)
+  set(value 0)
+  set(idx 0)
+  while (idx LESS length)
+    string(SUBSTRING "${hex}" ${idx} 1 digit)
+    string(FIND "0123456789abcdef" "${digit}" digit)
+    math(EXPR value "${value} * 16 + ${digit}")
+    math(EXPR idx "${idx} + 1")
+  endwhile ()
+  set(${result} ${value} PARENT_SCOPE)
+endfunction ()
+
+execute_process(
+  COMMAND ${NM} -C -S --size-sort ${LIBRARY}
+  OUTPUT_VARIABLE symbols
+  RESULT_VARIABLE status)
+if (NOT status EQUAL 0)
+  message(FATAL_ERROR "code_size.cmake: ${NM} failed on ${LIBRARY}")
+endif ()
+
+set(report "retain_ptr code size report for ${LIBRARY}\n\n")
+string(APPEND report "Out of line functions (bytes, kind, name):\n")
+set(total 0)
+set(count 0)
+string(REPLACE "\n" ";" symbols "${symbols}")
+foreach (line IN LISTS symbols)
+  if (NOT line MATCHES "^[0-9a-fA-F]+ ([0-9a-fA-F]+) ([tTwW]) (.*)$")
+    continue ()
+  endif ()
+  set(hex "${CMAKE_MATCH_1}")
+  set(type "${CMAKE_MATCH_2}")
+  set(name "${CMAKE_MATCH_3}")
+  if (NOT name MATCHES "sg14::|^code_size_")
+    continue ()
+  endif ()
+  hex_to_decimal(${hex} size)
+  math(EXPR total "${total} + ${size}")
+  math(EXPR count "${count} + 1")
+  string(APPEND report "  ${size}\t${type}\t${name}\n")
+endforeach ()
+string(APPEND report "  ${total} bytes in ${count} functions\n")
+
+execute_process(
+  COMMAND ${OBJDUMP} -dr -C --no-show-raw-insn ${LIBRARY}
+  OUTPUT_VARIABLE disassembly
+  RESULT_VARIABLE status)
+if (NOT status EQUAL 0)
+  message(FATAL_ERROR "code_size.cmake: ${OBJDUMP} failed on ${LIBRARY}")
+endif ()
+
+set(failures)
+set(listings)
+string(APPEND report "\nInlining of retain_traits into the entry points:\n")
+foreach (kind atomic padded local biased)
+  foreach (operation copy destroy assign compare)
+    set(symbol code_size_${operation}_${kind})
+    string(REGEX MATCH "<${symbol}>:\n([^\n]+\n)*" listing "${disassembly}")
+    string(REGEX MATCHALL "R_[A-Z0-9_]+[ \t]+[^\n]+" relocations "${listing}")
+    set(calls)
+    set(inlined yes)
+    foreach (relocation IN LISTS relocations)
+      string(REGEX REPLACE "^R_[A-Z0-9_]+[ \t]+" "" callee "${relocation}")
+      string(REGEX REPLACE "[-+]0x[0-9a-fA-F]+$" "" callee "${callee}")
+      list(APPEND calls "${callee}")
+      if (callee MATCHES "retain_traits<.*>::(increment|decrement|release)")
+        set(inlined no)
+      endif ()
+    endforeach ()
+    list(REMOVE_DUPLICATES calls)
+    string(REPLACE ";" ", " calls "${calls}")
+    if (NOT calls)
+      set(calls "none")
+    endif ()
+    string(APPEND report "  ${symbol}: retain_traits inlined: ${inlined}; references: ${calls}\n")
+    if (NOT inlined AND kind IN_LIST REQUIRE_INLINE)
+      list(APPEND failures ${symbol})
+    endif ()
+    if (operation MATCHES "copy|destroy")
+      string(APPEND listings "\n${listing}")
+    endif ()
+  endforeach ()
+endforeach ()
+
+string(APPEND report "\nCopy constructor and destructor disassembly:\n${listings}")
+
+message("${report}")
+if (OUTPUT)
+  file(WRITE ${OUTPUT} "${report}")
+endif ()
+if (failures)
+  message(FATAL_ERROR "retain_traits was not inlined into: ${failures}")
+endif ()
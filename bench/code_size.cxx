@@ -0,0 +1,50 @@
+#include <sg14/memory.hpp>
+
+#include <new>
+
+/* Instantiation matrix inspected by code_size.cmake. Every counting mixin is
+ * instantiated for several element types, and each mixin gets a set of
+ * extern "C" entry points with stable names whose disassembly shows what a
+ * copy, a destruction or a comparison of retain_ptr turns into.
+ */
+namespace code_size {
+
+template <int N> struct atomic_object : sg14::atomic_reference_count<atomic_object<N>> { long value; };
+template <int N> struct padded_object : sg14::atomic_reference_count<padded_object<N>, sg14::padded> { long value; };
+template <int N> struct local_object : sg14::reference_count<local_object<N>> { long value; };
+template <int N> struct biased_object : sg14::biased_reference_count<biased_object<N>> { long value; };
+
+} /* namespace code_size */
+
+#define SG14_CODE_SIZE_MATRIX(object) \
+  template struct sg14::retain_ptr<code_size::object<0>>; \
+  template struct sg14::retain_ptr<code_size::object<1>>; \
+  template struct sg14::retain_ptr<code_size::object<2>>; \
+  template struct sg14::retain_ptr<code_size::object<3>>;
+
+SG14_CODE_SIZE_MATRIX(atomic_object)
+SG14_CODE_SIZE_MATRIX(padded_object)
+SG14_CODE_SIZE_MATRIX(local_object)
+SG14_CODE_SIZE_MATRIX(biased_object)
+
+#define SG14_CODE_SIZE_ENTRIES(kind) \
+  extern "C" void code_size_copy_##kind ( \
+    void* storage, \
+    sg14::retain_ptr<code_size::kind##_object<0>> const& that \
+  ) { ::new (storage) sg14::retain_ptr<code_size::kind##_object<0>>(that); } \
+  extern "C" void code_size_destroy_##kind (sg14::retain_ptr<code_size::kind##_object<0>>* ptr) { \
+    ptr->~retain_ptr(); \
+  } \
+  extern "C" void code_size_assign_##kind ( \
+    sg14::retain_ptr<code_size::kind##_object<0>>& lhs, \
+    sg14::retain_ptr<code_size::kind##_object<0>> const& rhs \
+  ) { lhs = rhs; } \
+  extern "C" bool code_size_compare_##kind ( \
+    sg14::retain_ptr<code_size::kind##_object<0>> const& lhs, \
+    sg14::retain_ptr<code_size::kind##_object<0>> const& rhs \
+  ) { return lhs < rhs or lhs == nullptr; }
+
+SG14_CODE_SIZE_ENTRIES(atomic)
+SG14_CODE_SIZE_ENTRIES(padded)
+SG14_CODE_SIZE_ENTRIES(local)
+SG14_CODE_SIZE_ENTRIES(biased)
@@ -0,0 +1,77 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+#include <cstdio>
+#include <vector>
+
+#if defined(__GLIBC__)
+  #include <malloc.h>
+#endif
+
+namespace {
+
+/* A typical small node: a count, a key and two links. */
+template <class... Options>
+struct node : sg14::atomic_reference_count<node<Options...>, Options...> {
+  std::uint32_t key { };
+  void* prev { };
+  void* next { };
+};
+
+long heap_in_use () {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  return static_cast<long>(mallinfo2().uordblks);
+#else
+  return -1;
+#endif
+}
+
+/* Allocates count nodes and keeps them alive, reporting the time per node
+ * and the heap each one takes including allocator overhead.
+ */
+template <class Node>
+void populate (bench::recorder& out, char const* type, std::size_t count) {
+  std::vector<sg14::retain_ptr<Node>> nodes;
+  nodes.reserve(count);
+  auto const before = heap_in_use();
+  auto result = bench::measure([&] {
+    for (std::size_t idx = 0; idx < count; ++idx) {
+      nodes.emplace_back(new Node);
+      nodes.back()->key = static_cast<std::uint32_t>(idx);
+    }
+  });
+  auto const after = heap_in_use();
+  char name[64];
+  if (before < 0) {
+    std::snprintf(name, sizeof(name), "new %s, %zu B", type, sizeof(Node));
+  } else {
+    std::snprintf(
+      name,
+      sizeof(name),
+      "new %s, %zu B, %.0f B heap",
+      type,
+      sizeof(Node),
+      static_cast<double>(after - before) / static_cast<double>(count));
+  }
+  out.record("count_width", name, 1, count, result);
+
+  result = bench::measure([&] { nodes.clear(); });
+  std::snprintf(name, sizeof(name), "release %s", type);
+  out.record("count_width", name, 1, count, result);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  bench::recorder out { argc, argv };
+  auto const count = bench::iterations(argc, argv, 1 << 24);
+  { /* Grow the heap once so the first entry does not pay for faulting it in. */
+    std::vector<sg14::retain_ptr<node<>>> warm;
+    warm.reserve(count);
+    for (std::size_t idx = 0; idx < count; ++idx) { warm.emplace_back(new node<>); }
+  }
+  populate<node<>>(out, "long", count);
+  populate<node<std::uint32_t>>(out, "uint32_t", count);
+  populate<node<std::uint16_t>>(out, "uint16_t", count);
+  populate<node<std::uint32_t, sg14::checked>>(out, "checked uint32_t", count);
+}
@@ -0,0 +1,72 @@
+#include <bench.hpp>
+#include <sg14/cycle_detector.hpp>
+
+namespace {
+
+struct plain_vertex : sg14::atomic_reference_count<plain_vertex>, sg14::tracked<plain_vertex, false> {
+  sg14::retain_ptr<plain_vertex> next;
+};
+
+struct tracked_vertex : sg14::atomic_reference_count<tracked_vertex>, sg14::tracked<tracked_vertex, true> {
+  sg14::retain_ptr<tracked_vertex> next;
+};
+
+template <bool Enabled>
+using vertex = std::conditional_t<Enabled, tracked_vertex, plain_vertex>;
+
+} /* nameless namespace */
+
+template <>
+struct sg14::retain_traversal<tracked_vertex> {
+  template <class Visitor>
+  static void traverse (tracked_vertex const& object, Visitor& visit) { visit(object.next); }
+};
+
+namespace {
+
+template <bool Enabled>
+void create_release (char const* name, std::size_t count) {
+  auto elapsed = bench::run([&] {
+    for (std::size_t i = 0; i < count; ++i) {
+      sg14::retain_ptr<vertex<Enabled>> ptr { new vertex<Enabled> };
+      bench::do_not_optimize(ptr);
+    }
+  });
+  bench::report("cycle_detector", name, 1, count, elapsed);
+}
+
+template <bool Enabled>
+void copy_release (char const* name, std::size_t count) {
+  sg14::retain_ptr<vertex<Enabled>> ptr { new vertex<Enabled> };
+  auto elapsed = bench::run([&] {
+    for (std::size_t i = 0; i < count; ++i) {
+      auto copy = ptr;
+      bench::do_not_optimize(copy);
+    }
+  });
+  bench::report("cycle_detector", name, 1, count, elapsed);
+}
+
+/* Time per tracked object of a full scan over a chain of live objects. */
+void scan (std::size_t size) {
+  sg14::retain_ptr<vertex<true>> head { new vertex<true> };
+  auto tail = head.get();
+  for (std::size_t i = 1; i < size; ++i) {
+    tail->next.reset(new vertex<true>);
+    tail = tail->next.get();
+  }
+  auto elapsed = bench::run([] { bench::do_not_optimize(sg14::find_leaked_cycles()); });
+  bench::report("cycle_detector", "find_leaked_cycles, per object", 1, size, elapsed);
+  while (head) { head = std::move(head->next); }
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 20);
+  create_release<false>("create/release, tracking disabled", count);
+  create_release<true>("create/release, tracking enabled", count);
+  copy_release<false>("copy/release, tracking disabled", count);
+  copy_release<true>("copy/release, tracking enabled", count);
+  scan(count / 16);
+}
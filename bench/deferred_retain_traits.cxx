@@ -0,0 +1,81 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+namespace {
+
+template <template <class> class Traits>
+struct message : sg14::atomic_reference_count<message<Traits>> {
+  using pointer = sg14::retain_ptr<message, Traits<message>>;
+  std::vector<char> payload = std::vector<char>(256);
+  pointer parent;
+};
+
+template <class T>
+using inline_traits = sg14::retain_traits<T>;
+
+template <class T>
+using deferred_traits = sg14::deferred_retain_traits<T>;
+
+/* retain_traits without its bulk forms, so a flush drops coalesced
+ * releases one fetch_sub at a time.
+ */
+template <class T>
+struct single_traits {
+  static void increment (T* ptr) noexcept { sg14::retain_traits<T>::increment(ptr); }
+  static void decrement (T* ptr) noexcept { sg14::retain_traits<T>::decrement(ptr); }
+  static long use_count (T* ptr) noexcept { return sg14::retain_traits<T>::use_count(ptr); }
+};
+
+template <class T>
+using deferred_single_traits = sg14::deferred_retain_traits<T, single_traits<T>>;
+
+constexpr std::size_t shared_objects = 64;
+constexpr std::size_t copies_per_request = 1000;
+constexpr std::size_t messages_per_request = 32;
+
+/* Each request copies long lived objects and builds short lived messages
+ * that all die when the request ends. Flushing happens between requests and
+ * is timed separately.
+ */
+template <template <class> class Traits>
+void requests (char const* name, char const* flush_name, std::size_t count) {
+  using pointer = typename message<Traits>::pointer;
+  std::vector<pointer> shared;
+  for (std::size_t i = 0; i < shared_objects; ++i) {
+    shared.emplace_back(new message<Traits>);
+  }
+  std::vector<double> latency;
+  std::vector<double> flush;
+  for (std::size_t request = 0; request < count; ++request) {
+    latency.push_back(bench::run([&] {
+      std::vector<pointer> held;
+      held.reserve(copies_per_request + messages_per_request);
+      for (std::size_t i = 0; i < copies_per_request; ++i) {
+        held.push_back(shared[i % shared_objects]);
+      }
+      for (std::size_t i = 0; i < messages_per_request; ++i) {
+        held.emplace_back(new message<Traits>);
+        held.back()->parent = shared[i % shared_objects];
+      }
+      bench::do_not_optimize(held.data());
+    }));
+    flush.push_back(bench::run([] { sg14::flush_deferred_releases(); }));
+  }
+  bench::report_percentiles("deferred_retain_traits", name, latency);
+  bench::report_percentiles("deferred_retain_traits", flush_name, flush);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 14);
+  requests<inline_traits>("request, inline release", "  flush between requests", count);
+  requests<deferred_single_traits>(
+    "request, deferred release",
+    "  flush, one decrement per release",
+    count);
+  requests<deferred_traits>(
+    "request, deferred release",
+    "  flush, one bulk decrement per object",
+    count);
+}
@@ -0,0 +1,54 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct message : sg14::atomic_reference_count<message> { long payload { }; };
+
+using message_ptr = sg14::retain_ptr<message>;
+
+/* Hands one message to `fan` subscribers and lets them drop it again,
+ * count copies in total.
+ */
+template <class Copy>
+void broadcast (
+  bench::recorder& out,
+  std::string const& name,
+  std::size_t fan,
+  std::size_t count,
+  Copy copy
+) {
+  message_ptr ptr { new message };
+  std::vector<message_ptr> subscribers;
+  subscribers.reserve(fan);
+  auto const rounds = count / fan;
+  auto result = bench::measure([&] {
+    for (std::size_t round = 0; round < rounds; ++round) {
+      copy(ptr, fan, subscribers);
+      bench::do_not_optimize(subscribers.data());
+      subscribers.clear();
+    }
+  });
+  out.record("fan_out", name.c_str(), 1, rounds * fan, result);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  bench::recorder out { argc, argv };
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+
+  for (std::size_t fan = 1; fan <= 1024; fan *= 4) {
+    auto const suffix = ", " + std::to_string(fan) + " copies";
+    broadcast(out, "copy loop" + suffix, fan, count, [] (auto& ptr, auto n, auto& into) {
+      for (std::size_t idx = 0; idx < n; ++idx) { into.push_back(ptr); }
+    });
+    broadcast(out, "clone_n" + suffix, fan, count, [] (auto& ptr, auto n, auto& into) {
+      ptr.clone_n(n, std::back_inserter(into));
+    });
+  }
+}
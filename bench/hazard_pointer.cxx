@@ -0,0 +1,46 @@
+#include <bench.hpp>
+#include <sg14/hazard_pointer.hpp>
+
+namespace {
+
+struct table : sg14::atomic_reference_count<table> {
+  std::size_t entries[8] { };
+};
+
+using table_ptr = sg14::retain_ptr<table>;
+
+/* Readers only: every thread repeatedly reads a field of the shared table,
+ * either borrowing it through a hazard pointer or taking a reference.
+ */
+template <class Read>
+void readers (char const* name, std::size_t threads, std::size_t count, Read read) {
+  auto elapsed = bench::run_threads(threads, [&] (std::size_t) {
+    for (std::size_t i = 0; i < count; ++i) {
+      bench::do_not_optimize(read(i));
+    }
+  });
+  bench::report("hazard_pointer", name, threads, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  table_ptr shared { new table };
+  sg14::hazard_retain_ptr<table> hazard_slot { shared };
+  sg14::atomic_retain_ptr<table> atomic_slot { shared };
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    readers("hazard_guard", threads, count, [&] (std::size_t i) {
+      auto guard = hazard_slot.protect();
+      return guard->entries[i % 8];
+    });
+    readers("retain_ptr copy", threads, count, [&] (std::size_t i) {
+      auto copy = shared;
+      return copy->entries[i % 8];
+    });
+    readers("atomic_retain_ptr load", threads, count, [&] (std::size_t i) {
+      auto copy = atomic_slot.load();
+      return copy->entries[i % 8];
+    });
+  }
+}
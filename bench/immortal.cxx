@@ -0,0 +1,51 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+#include <memory>
+
+namespace {
+
+struct object : sg14::atomic_reference_count<object> { long value { }; };
+struct singleton : sg14::atomic_reference_count<singleton, sg14::skip_immortal> {
+  long value { };
+};
+
+/* Every thread copies and drops the same pointer, as code handing out a
+ * global default or sentinel object does.
+ */
+template <class Ptr>
+void copy_release (
+  bench::recorder& out,
+  char const* name,
+  std::size_t threads,
+  std::size_t count,
+  Ptr const& ptr
+) {
+  auto result = bench::measure_threads(threads, [&] (std::size_t) {
+    for (std::size_t idx = 0; idx < count; ++idx) {
+      auto copy = ptr;
+      bench::do_not_optimize(copy);
+    }
+  });
+  out.record("immortal", name, threads, count * threads, result);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  bench::recorder out { argc, argv };
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  sg14::retain_ptr<object> mortal { new object };
+  sg14::retain_ptr<object> immortal { new object };
+  sg14::immortalize(immortal);
+  sg14::retain_ptr<singleton> skipped { new singleton };
+  sg14::immortalize(skipped);
+  auto shared = std::make_shared<object>();
+
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    copy_release(out, "copy/release, immortal, skip_immortal", threads, count, skipped);
+    copy_release(out, "copy/release, immortal", threads, count, immortal);
+    copy_release(out, "copy/release, mortal", threads, count, mortal);
+    copy_release(out, "copy/release, std::shared_ptr", threads, count, shared);
+  }
+}
@@ -0,0 +1,106 @@
+#include <bench.hpp>
+#include <sg14/intrusive.hpp>
+
+#include <deque>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct job :
+  sg14::atomic_reference_count<job>,
+  sg14::list_hook<>,
+  sg14::mpsc_hook<>
+{ long value { }; };
+
+using job_ptr = sg14::retain_ptr<job>;
+
+/* Cycles every job through the list count times in total, as a scheduler
+ * moving tasks between run queues would.
+ */
+template <class List>
+void rotate (
+  bench::recorder& out,
+  char const* name,
+  std::size_t count,
+  std::vector<job_ptr> const& jobs
+) {
+  List list;
+  for (auto& item : jobs) { list.push_back(item); }
+  auto result = bench::measure([&] {
+    for (std::size_t idx = 0; idx < count; ++idx) {
+      if constexpr (std::is_same_v<List, sg14::retain_list<job>>) {
+        list.push_back(list.pop_front());
+      } else {
+        auto item = std::move(list.front());
+        list.pop_front();
+        list.push_back(std::move(item));
+      }
+    }
+  });
+  out.record("intrusive", name, 1, count, result);
+}
+
+struct mutex_queue {
+  void push (job_ptr ptr) {
+    std::lock_guard<std::mutex> lock { this->mutex };
+    this->items.push_back(std::move(ptr));
+  }
+
+  job_ptr pop () {
+    std::lock_guard<std::mutex> lock { this->mutex };
+    if (this->items.empty()) { return nullptr; }
+    auto ptr = std::move(this->items.front());
+    this->items.pop_front();
+    return ptr;
+  }
+
+  std::mutex mutex;
+  std::deque<job_ptr> items;
+};
+
+/* Producers push count jobs in total while one consumer drains them. */
+template <class Queue>
+void produce (
+  bench::recorder& out,
+  char const* name,
+  std::size_t producers,
+  std::size_t count,
+  std::vector<job_ptr> const& jobs
+) {
+  Queue queue;
+  auto per_producer = count / producers;
+  auto result = bench::measure_threads(producers + 1, [&] (std::size_t id) {
+    if (id == producers) {
+      for (std::size_t received = 0; received < per_producer * producers; ) {
+        if (queue.pop()) { ++received; }
+      }
+      return;
+    }
+    for (std::size_t idx = 0; idx < per_producer; ++idx) {
+      queue.push(jobs[(id * per_producer + idx) % jobs.size()]);
+    }
+  });
+  out.record("intrusive", name, producers, per_producer * producers, result);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  bench::recorder out { argc, argv };
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  std::vector<job_ptr> jobs;
+  for (int idx = 0; idx < 1024; ++idx) { jobs.emplace_back(new job); }
+
+  rotate<sg14::retain_list<job>>(out, "rotate, retain_list", count, jobs);
+  rotate<std::list<job_ptr>>(out, "rotate, std::list<retain_ptr>", count, jobs);
+  rotate<std::deque<job_ptr>>(out, "rotate, std::deque<retain_ptr>", count, jobs);
+
+  for (std::size_t producers = 1; producers <= bench::max_threads(); producers *= 2) {
+    std::vector<job_ptr> distinct;
+    for (std::size_t idx = 0; idx < count / 4; ++idx) { distinct.emplace_back(new job); }
+    produce<sg14::retain_mpsc_queue<job>>(out, "mpsc, retain_mpsc_queue", producers, count / 4, distinct);
+    produce<mutex_queue>(out, "mpsc, mutex and std::deque", producers, count / 4, distinct);
+  }
+}
@@ -0,0 +1,121 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+namespace {
+
+/* Single threaded free-list arena: freed blocks of a size are recycled
+ * before new memory is carved out of the current chunk. Each 16 byte size
+ * class up to max_size has its own free list; larger blocks bypass the arena.
+ */
+struct arena {
+  static constexpr std::size_t chunk_size = 1 << 20;
+  static constexpr std::size_t max_size = 1024;
+
+  arena () = default;
+  arena (arena const&) = delete;
+  ~arena () { for (auto chunk : this->chunks) { ::operator delete(chunk); } }
+
+  void* allocate (std::size_t size) {
+    size = (size + 15) & ~std::size_t { 15 };
+    if (size > max_size) { return ::operator new(size); }
+    auto& list = this->free_list(size);
+    if (list) {
+      auto block = list;
+      list = *static_cast<void**>(block);
+      return block;
+    }
+    if (this->used + size > chunk_size or this->chunks.empty()) {
+      this->chunks.push_back(::operator new(chunk_size));
+      this->used = 0;
+    }
+    auto block = static_cast<char*>(this->chunks.back()) + this->used;
+    this->used += size;
+    return block;
+  }
+
+  void deallocate (void* block, std::size_t size) noexcept {
+    size = (size + 15) & ~std::size_t { 15 };
+    if (size > max_size) { return ::operator delete(block); }
+    auto& list = this->free_list(size);
+    *static_cast<void**>(block) = list;
+    list = block;
+  }
+
+private:
+  void*& free_list (std::size_t size) { return this->lists[size / 16 - 1]; }
+
+  std::vector<void*> chunks;
+  std::size_t used = 0;
+  void* lists[max_size / 16] { };
+};
+
+template <class T>
+struct arena_allocator {
+  using value_type = T;
+
+  explicit arena_allocator (arena* pool) noexcept : pool { pool } { }
+  template <class U>
+  arena_allocator (arena_allocator<U> const& that) noexcept : pool { that.pool } { }
+
+  T* allocate (std::size_t n) {
+    return static_cast<T*>(this->pool->allocate(n * sizeof(T)));
+  }
+  void deallocate (T* ptr, std::size_t n) noexcept {
+    this->pool->deallocate(ptr, n * sizeof(T));
+  }
+
+  template <class U>
+  bool operator == (arena_allocator<U> const& that) const noexcept { return this->pool == that.pool; }
+  template <class U>
+  bool operator != (arena_allocator<U> const& that) const noexcept { return this->pool != that.pool; }
+
+  arena* pool;
+};
+
+struct message : sg14::atomic_reference_count<message> {
+  explicit message (std::size_t id) : id { id } { }
+  std::size_t id;
+  char payload[48];
+};
+
+struct plain_message {
+  explicit plain_message (std::size_t id) : id { id } { }
+  std::size_t id;
+  char payload[48];
+};
+
+constexpr std::size_t batch = 256;
+
+/* Allocates in batches so the allocator sees live objects, not just a
+ * single block bouncing back and forth.
+ */
+template <class Make>
+void churn (char const* name, std::size_t count, Make make) {
+  using pointer = decltype(make(0));
+  std::vector<pointer> live(batch);
+  auto elapsed = bench::run([&] {
+    for (std::size_t i = 0; i < count; ++i) {
+      live[i % batch] = make(i);
+    }
+  });
+  bench::report("make_retained", name, 1, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  arena pool;
+  churn("make_retained", count, [] (std::size_t i) {
+    return sg14::make_retained<message>(i);
+  });
+  churn("allocate_retained (arena)", count, [&] (std::size_t i) {
+    return sg14::allocate_retained<message>(arena_allocator<message> { &pool }, i);
+  });
+  churn("make_shared", count, [] (std::size_t i) {
+    return std::make_shared<plain_message>(i);
+  });
+  churn("allocate_shared (arena)", count, [&] (std::size_t i) {
+    return std::allocate_shared<plain_message>(arena_allocator<plain_message> { &pool }, i);
+  });
+}
@@ -0,0 +1,49 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+namespace {
+
+/* Read-mostly object whose hot fields sit right after the counter. */
+template <class Layout>
+struct route : sg14::atomic_reference_count<route<Layout>, Layout> {
+  std::size_t fields[6] { 1, 2, 3, 4, 5, 6 };
+};
+
+/* Half of the threads sum the object's fields, the other half keep copying
+ * retain_ptrs to it until the readers are done. Only reader iterations are
+ * counted, so the figure is the cost of a field read under count traffic.
+ */
+template <class Layout>
+void readers_under_copies (char const* name, std::size_t threads, std::size_t count) {
+  using pointer = sg14::retain_ptr<route<Layout>>;
+  pointer ptr { new route<Layout> };
+  std::size_t const readers = threads / 2;
+  std::atomic<std::size_t> remaining { readers };
+  auto elapsed = bench::run_threads(threads, [&] (std::size_t idx) {
+    if (idx % 2) {
+      while (remaining.load(std::memory_order_relaxed)) {
+        auto copy = ptr;
+        bench::do_not_optimize(copy);
+      }
+      return;
+    }
+    auto const& fields = ptr->fields;
+    for (std::size_t i = 0; i < count; ++i) {
+      std::size_t sum = 0;
+      for (auto field : fields) { sum += field; }
+      bench::do_not_optimize(sum);
+    }
+    remaining.fetch_sub(1, std::memory_order_relaxed);
+  });
+  bench::report("padded_reference_count", name, threads, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  for (std::size_t threads = 2; threads <= std::max<std::size_t>(2, bench::max_threads()); threads *= 2) {
+    readers_under_copies<sg14::compact>("field reads, compact counter", threads, count);
+    readers_under_copies<sg14::padded>("field reads, padded counter", threads, count);
+  }
+}
@@ -0,0 +1,67 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+namespace {
+
+struct base : sg14::atomic_reference_count<base> {
+  virtual ~base () = default;
+};
+
+struct derived : base { };
+
+/* Counts the atomic operations made on behalf of the retain_ptrs. */
+struct counting_traits {
+  static inline std::size_t operations = 0;
+  static void increment (base* ptr) noexcept {
+    ++operations;
+    sg14::retain_traits<base>::increment(ptr);
+  }
+  static void decrement (base* ptr) noexcept {
+    ++operations;
+    sg14::retain_traits<base>::decrement(ptr);
+  }
+};
+
+using base_ptr = sg14::retain_ptr<base, counting_traits>;
+
+/* Casts back and forth `count` times; cast(ptr) must return a base_ptr. */
+template <class Cast>
+void round_trip (char const* name, std::size_t count, Cast cast) {
+  base_ptr ptr { new derived };
+  counting_traits::operations = 0;
+  auto elapsed = bench::run([&] {
+    for (std::size_t i = 0; i < count; ++i) {
+      ptr = cast(ptr);
+      bench::do_not_optimize(ptr);
+    }
+  });
+  char label[64];
+  std::snprintf(
+    label,
+    sizeof(label),
+    "%s, %.1f atomics",
+    name,
+    static_cast<double>(counting_traits::operations) / static_cast<double>(count));
+  bench::report("pointer_cast", label, 1, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  round_trip("get + retain_object", count, [] (base_ptr& ptr) {
+    return base_ptr(static_cast<derived*>(ptr.get()), sg14::retain_object);
+  });
+  round_trip("static lvalue", count, [] (base_ptr& ptr) {
+    return base_ptr { sg14::static_pointer_cast<derived>(ptr) };
+  });
+  round_trip("static rvalue", count, [] (base_ptr& ptr) {
+    return base_ptr { sg14::static_pointer_cast<derived>(std::move(ptr)) };
+  });
+  round_trip("dynamic lvalue", count, [] (base_ptr& ptr) {
+    return base_ptr { sg14::dynamic_pointer_cast<derived>(ptr) };
+  });
+  round_trip("dynamic rvalue", count, [] (base_ptr& ptr) {
+    return base_ptr { sg14::dynamic_pointer_cast<derived>(std::move(ptr)) };
+  });
+}
@@ -0,0 +1,50 @@
+#include <bench.hpp>
+#include <sg14/hazard_pointer.hpp>
+#include <sg14/rcu.hpp>
+
+namespace {
+
+struct table : sg14::atomic_reference_count<table> {
+  std::size_t entries[8] { };
+};
+
+using table_ptr = sg14::retain_ptr<table>;
+
+template <class Read>
+void readers (char const* name, std::size_t threads, std::size_t count, Read read) {
+  auto elapsed = bench::run_threads(threads, [&] (std::size_t) {
+    for (std::size_t i = 0; i < count; ++i) {
+      bench::do_not_optimize(read(i));
+    }
+  });
+  bench::report("rcu", name, threads, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  table_ptr shared { new table };
+  sg14::rcu_retain_ptr<table> rcu_slot { shared };
+  sg14::hazard_retain_ptr<table> hazard_slot { shared };
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    readers("rcu_read_guard", threads, count, [&] (std::size_t i) {
+      sg14::rcu_read_guard guard;
+      return rcu_slot.get(guard)->entries[i % 8];
+    });
+    readers("rcu_read_guard, 16 reads", threads, count / 16, [&] (std::size_t i) {
+      sg14::rcu_read_guard guard;
+      std::size_t sum = 0;
+      for (std::size_t n = 0; n < 16; ++n) { sum += rcu_slot.get(guard)->entries[(i + n) % 8]; }
+      return sum;
+    });
+    readers("hazard_guard", threads, count, [&] (std::size_t i) {
+      auto guard = hazard_slot.protect();
+      return guard->entries[i % 8];
+    });
+    readers("retain_ptr copy", threads, count, [&] (std::size_t i) {
+      auto copy = shared;
+      return copy->entries[i % 8];
+    });
+  }
+}
@@ -0,0 +1,50 @@
+#include <bench.hpp>
+#include <sg14/reclaimer.hpp>
+
+#include <memory>
+
+namespace {
+
+/* A parsed document tree stand-in whose destruction frees thousands of
+ * small allocations.
+ */
+template <class Reclaimer>
+struct tree :
+  sg14::atomic_reference_count<tree<Reclaimer>>,
+  sg14::reclaim_hook
+{
+  using pointer = sg14::retain_ptr<
+    tree,
+    sg14::reclaiming_retain_traits<tree, Reclaimer>
+  >;
+
+  explicit tree (std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      this->nodes.push_back(std::make_unique<std::size_t>(i));
+    }
+  }
+
+  std::vector<std::unique_ptr<std::size_t>> nodes;
+};
+
+template <class Reclaimer>
+void release_latency (char const* name, std::size_t count, std::size_t size) {
+  using pointer = typename tree<Reclaimer>::pointer;
+  std::vector<double> latency;
+  for (std::size_t i = 0; i < count; ++i) {
+    pointer ptr { new tree<Reclaimer> { size } };
+    latency.push_back(bench::run([&] { ptr = nullptr; }));
+  }
+  bench::report_percentiles("reclaimer", name, latency);
+  sg14::background_reclaimer::drain();
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 10);
+  release_latency<sg14::inline_reclaimer>("final release, inline 1k nodes", count, 1 << 10);
+  release_latency<sg14::background_reclaimer>("final release, background 1k nodes", count, 1 << 10);
+  release_latency<sg14::inline_reclaimer>("final release, inline 64k nodes", count / 8, 1 << 16);
+  release_latency<sg14::background_reclaimer>("final release, background 64k nodes", count / 8, 1 << 16);
+}
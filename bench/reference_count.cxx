@@ -0,0 +1,63 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+namespace {
+
+struct object : sg14::atomic_reference_count<object> { };
+struct local_object : sg14::reference_count<local_object> { };
+
+/* Reproduces the previous release sequence, which re-read the count after the
+ * fetch_sub, so the two can be compared side by side.
+ */
+struct legacy_object { std::atomic<long> count { 1 }; };
+
+struct legacy_traits {
+  static void increment (legacy_object* ptr) noexcept {
+    ptr->count.fetch_add(1, std::memory_order_relaxed);
+  }
+  static void decrement (legacy_object* ptr) noexcept {
+    ptr->count.fetch_sub(1, std::memory_order_acq_rel);
+    if (not ptr->count.load(std::memory_order_relaxed)) { delete ptr; }
+  }
+};
+
+template <class Ptr>
+void copy_release (char const* name, std::size_t threads, std::size_t count, Ptr ptr) {
+  auto elapsed = bench::run_threads(threads, [&] (std::size_t) {
+    for (std::size_t i = 0; i < count; ++i) {
+      auto copy = ptr;
+      bench::do_not_optimize(copy);
+    }
+  });
+  bench::report("reference_count", name, threads, count, elapsed);
+}
+
+template <class Make>
+void create_release (char const* name, std::size_t count, Make make) {
+  auto elapsed = bench::run([&] {
+    for (std::size_t i = 0; i < count; ++i) {
+      auto ptr = make();
+      bench::do_not_optimize(ptr);
+    }
+  });
+  bench::report("reference_count", name, 1, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  using atomic_ptr = sg14::retain_ptr<object>;
+  using legacy_ptr = sg14::retain_ptr<legacy_object, legacy_traits>;
+  using local_ptr = sg14::retain_ptr<local_object>;
+
+  create_release("create/release atomic", count, [] { return atomic_ptr { new object }; });
+  create_release("create/release legacy", count, [] { return legacy_ptr { new legacy_object }; });
+  create_release("create/release local", count, [] { return local_ptr { new local_object }; });
+
+  copy_release("copy/release local", 1, count, local_ptr { new local_object });
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    copy_release("copy/release atomic", threads, count, atomic_ptr { new object });
+    copy_release("copy/release legacy", threads, count, legacy_ptr { new legacy_object });
+  }
+}
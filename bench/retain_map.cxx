@@ -0,0 +1,91 @@
+#include <bench.hpp>
+#include <sg14/retain_map.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct object : sg14::atomic_reference_count<object> { long value { }; };
+
+constexpr std::size_t entries = 1 << 16;
+
+/* Probes for every key in a shuffled order, count times in total. */
+template <class Keys, class F>
+void lookup (
+  bench::recorder& out,
+  char const* name,
+  std::size_t count,
+  Keys const& keys,
+  F find
+) {
+  auto result = bench::measure([&] {
+    long sum = 0;
+    for (std::size_t idx = 0; idx < count; ++idx) { sum += find(keys[idx % keys.size()]); }
+    bench::do_not_optimize(sum);
+  });
+  out.record("retain_map", name, 1, count, result);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  bench::recorder out { argc, argv };
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+
+  std::vector<sg14::retain_ptr<object>> retained;
+  std::vector<std::shared_ptr<object>> shared;
+  for (std::size_t idx = 0; idx < entries; ++idx) {
+    retained.emplace_back(new object);
+    shared.push_back(std::make_shared<object>());
+  }
+
+  auto result = bench::measure([&] {
+    sg14::retain_map<object, long> map;
+    for (auto& key : retained) { map.try_emplace(key, 1); }
+    bench::do_not_optimize(map.size());
+  });
+  out.record("retain_map", "insert, retain_map", 1, entries, result);
+  result = bench::measure([&] {
+    std::unordered_map<std::shared_ptr<object>, long> map;
+    for (auto& key : shared) { map.emplace(key, 1); }
+    bench::do_not_optimize(map.size());
+  });
+  out.record("retain_map", "insert, unordered_map<shared_ptr>", 1, entries, result);
+
+  sg14::retain_map<object, long> retain_map;
+  std::unordered_map<sg14::retain_ptr<object>, long> unordered_retain;
+  std::unordered_map<std::shared_ptr<object>, long> unordered_shared;
+  for (auto& key : retained) {
+    retain_map.try_emplace(key, 1);
+    unordered_retain.emplace(key, 1);
+  }
+  for (auto& key : shared) { unordered_shared.emplace(key, 1); }
+
+  std::mt19937 engine { 42 };
+  std::vector<object*> raw;
+  for (auto& key : retained) { raw.push_back(key.get()); }
+  std::shuffle(raw.begin(), raw.end(), engine);
+  std::vector<object*> raw_shared;
+  for (auto& key : shared) { raw_shared.push_back(key.get()); }
+  std::shuffle(raw_shared.begin(), raw_shared.end(), engine);
+  std::vector<std::shared_ptr<object>> shuffled_shared { shared };
+  std::shuffle(shuffled_shared.begin(), shuffled_shared.end(), engine);
+
+  lookup(out, "find raw, retain_map", count, raw, [&] (object* key) {
+    return *retain_map.find(key);
+  });
+  lookup(out, "find retained, unordered_map<retain_ptr>", count, raw, [&] (object* key) {
+    return unordered_retain.find(sg14::retain_ptr<object>(key, sg14::retain_object))->second;
+  });
+  lookup(out, "find held, unordered_map<shared_ptr>", count, shuffled_shared, [&] (auto const& key) {
+    return unordered_shared.find(key)->second;
+  });
+  /* What a cache keyed by identity has to do when handed a raw pointer. */
+  lookup(out, "find raw, unordered_map<shared_ptr>", count, raw_shared, [&] (object* key) {
+    return unordered_shared.find(std::shared_ptr<object>(std::shared_ptr<object> { }, key))->second;
+  });
+}
@@ -0,0 +1,270 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+namespace {
+
+struct atomic_object : sg14::atomic_reference_count<atomic_object> { long value { }; };
+struct local_object : sg14::reference_count<local_object> { long value { }; };
+struct plain_object { long value { }; };
+
+/* Minimal boost::intrusive_ptr work-alike, found through ADL hooks. */
+struct intrusive_object {
+  friend void intrusive_ptr_add_ref (intrusive_object* ptr) noexcept {
+    ptr->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  friend void intrusive_ptr_release (intrusive_object* ptr) noexcept {
+    if (ptr->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) { delete ptr; }
+  }
+
+  std::atomic<long> refs { 0 };
+  long value { };
+};
+
+template <class T>
+struct intrusive_ptr {
+  intrusive_ptr () noexcept = default;
+  explicit intrusive_ptr (T* ptr) noexcept : ptr { ptr } {
+    if (ptr) { intrusive_ptr_add_ref(ptr); }
+  }
+  intrusive_ptr (intrusive_ptr const& that) noexcept : intrusive_ptr { that.ptr } { }
+  intrusive_ptr (intrusive_ptr&& that) noexcept : ptr { std::exchange(that.ptr, nullptr) } { }
+  ~intrusive_ptr () { if (this->ptr) { intrusive_ptr_release(this->ptr); } }
+
+  intrusive_ptr& operator = (intrusive_ptr const& that) noexcept {
+    intrusive_ptr(that).swap(*this);
+    return *this;
+  }
+
+  intrusive_ptr& operator = (intrusive_ptr&& that) noexcept {
+    intrusive_ptr(std::move(that)).swap(*this);
+    return *this;
+  }
+
+  void swap (intrusive_ptr& that) noexcept { std::swap(this->ptr, that.ptr); }
+  void reset (T* ptr = nullptr) { intrusive_ptr(ptr).swap(*this); }
+  T* operator -> () const noexcept { return this->ptr; }
+  T* get () const noexcept { return this->ptr; }
+
+private:
+  T* ptr { nullptr };
+};
+
+template <class T>
+void swap (intrusive_ptr<T>& lhs, intrusive_ptr<T>& rhs) noexcept { lhs.swap(rhs); }
+
+/* Each kind names a pointer type, how to make a new object for it, how to
+ * reset a pointer to a new object and how to give that object back; only
+ * raw pointers need the latter, and reset them by hand.
+ */
+struct atomic_retain {
+  using pointer = sg14::retain_ptr<atomic_object>;
+  static constexpr char const* name = "retain_ptr atomic";
+  static constexpr bool thread_safe = true;
+  static pointer make (long value) {
+    pointer ptr { new atomic_object };
+    ptr->value = value;
+    return ptr;
+  }
+  static void reset (pointer& ptr, long value) {
+    ptr.reset(new atomic_object);
+    ptr->value = value;
+  }
+  static void dispose (pointer&) noexcept { }
+};
+
+struct local_retain {
+  using pointer = sg14::retain_ptr<local_object>;
+  static constexpr char const* name = "retain_ptr local";
+  static constexpr bool thread_safe = false;
+  static pointer make (long value) {
+    pointer ptr { new local_object };
+    ptr->value = value;
+    return ptr;
+  }
+  static void reset (pointer& ptr, long value) {
+    ptr.reset(new local_object);
+    ptr->value = value;
+  }
+  static void dispose (pointer&) noexcept { }
+};
+
+struct shared {
+  using pointer = std::shared_ptr<plain_object>;
+  static constexpr char const* name = "shared_ptr";
+  static constexpr bool thread_safe = true;
+  static pointer make (long value) {
+    auto ptr = std::make_shared<plain_object>();
+    ptr->value = value;
+    return ptr;
+  }
+  static void reset (pointer& ptr, long value) { ptr.reset(new plain_object { value }); }
+  static void dispose (pointer&) noexcept { }
+};
+
+struct intrusive {
+  using pointer = intrusive_ptr<intrusive_object>;
+  static constexpr char const* name = "intrusive_ptr";
+  static constexpr bool thread_safe = true;
+  static pointer make (long value) {
+    pointer ptr { new intrusive_object };
+    ptr->value = value;
+    return ptr;
+  }
+  static void reset (pointer& ptr, long value) {
+    ptr.reset(new intrusive_object);
+    ptr->value = value;
+  }
+  static void dispose (pointer&) noexcept { }
+};
+
+struct raw {
+  using pointer = plain_object*;
+  static constexpr char const* name = "raw pointer";
+  static constexpr bool thread_safe = true;
+  static pointer make (long value) { return new plain_object { value }; }
+  static void reset (pointer& ptr, long value) {
+    delete ptr;
+    ptr = new plain_object { value };
+  }
+  static void dispose (pointer& ptr) noexcept { delete std::exchange(ptr, nullptr); }
+};
+
+template <class Kind>
+struct suite {
+  using pointer = typename Kind::pointer;
+
+  suite (bench::recorder& out, std::size_t count) : out { out }, count { count } { }
+
+  void record (char const* operation, std::size_t threads, std::size_t ops, bench::measurement result) {
+    this->out.record("retain_ptr", std::string { Kind::name } + " " + operation, threads, ops, result);
+  }
+
+  void copy () {
+    auto ptr = Kind::make(1);
+    this->record("copy", 1, this->count, bench::measure([&] {
+      for (std::size_t i = 0; i < this->count; ++i) {
+        pointer copy = ptr;
+        bench::do_not_optimize(copy);
+      }
+    }));
+    Kind::dispose(ptr);
+  }
+
+  void move () {
+    auto ptr = Kind::make(1);
+    this->record("move", 1, this->count, bench::measure([&] {
+      for (std::size_t i = 0; i < this->count; ++i) {
+        pointer moved = std::move(ptr);
+        bench::do_not_optimize(moved);
+        ptr = std::move(moved);
+      }
+    }));
+    Kind::dispose(ptr);
+  }
+
+  void destroy () {
+    auto ptr = Kind::make(1);
+    std::vector<pointer> copies(this->count, ptr);
+    this->record("destroy", 1, this->count, bench::measure([&] { copies.clear(); }));
+    Kind::dispose(ptr);
+  }
+
+  void reset () {
+    auto ptr = Kind::make(0);
+    this->record("reset", 1, this->count, bench::measure([&] {
+      for (std::size_t i = 0; i < this->count; ++i) {
+        Kind::reset(ptr, static_cast<long>(i));
+        bench::do_not_optimize(ptr);
+      }
+    }));
+    Kind::dispose(ptr);
+  }
+
+  void swap () {
+    auto lhs = Kind::make(1);
+    auto rhs = Kind::make(2);
+    this->record("swap", 1, this->count, bench::measure([&] {
+      using std::swap;
+      for (std::size_t i = 0; i < this->count; ++i) {
+        swap(lhs, rhs);
+        bench::do_not_optimize(lhs);
+      }
+    }));
+    Kind::dispose(lhs);
+    Kind::dispose(rhs);
+  }
+
+  void push () {
+    auto ptr = Kind::make(1);
+    std::vector<pointer> copies;
+    this->record("vector push_back", 1, this->count, bench::measure([&] {
+      for (std::size_t i = 0; i < this->count; ++i) { copies.push_back(ptr); }
+    }));
+    copies.clear();
+    Kind::dispose(ptr);
+  }
+
+  void sort () {
+    auto const size = this->count / 16;
+    std::vector<pointer> objects;
+    std::uint32_t state = 2463534242u;
+    for (std::size_t i = 0; i < size; ++i) {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      objects.push_back(Kind::make(static_cast<long>(state)));
+    }
+    this->record("vector sort", 1, size, bench::measure([&] {
+      std::sort(objects.begin(), objects.end(), [] (pointer const& lhs, pointer const& rhs) {
+        return lhs->value < rhs->value;
+      });
+    }));
+    for (auto& object : objects) { Kind::dispose(object); }
+  }
+
+  void storm (std::size_t threads) {
+    auto ptr = Kind::make(1);
+    this->record("copy storm", threads, this->count, bench::measure_threads(threads, [&] (std::size_t) {
+      for (std::size_t i = 0; i < this->count; ++i) {
+        pointer copy = ptr;
+        bench::do_not_optimize(copy);
+      }
+    }));
+    Kind::dispose(ptr);
+  }
+
+  void run () {
+    this->copy();
+    this->move();
+    this->destroy();
+    this->reset();
+    this->swap();
+    this->push();
+    this->sort();
+    if (not Kind::thread_safe) { return; }
+    for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+      this->storm(threads);
+    }
+  }
+
+  bench::recorder& out;
+  std::size_t count;
+};
+
+template <class... Kinds>
+void run_all (bench::recorder& out, std::size_t count) {
+  (suite<Kinds> { out, count }.run(), ...);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 21);
+  bench::recorder out { argc, argv };
+  run_all<atomic_retain, local_retain, shared, intrusive, raw>(out, count);
+}
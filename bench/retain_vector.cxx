@@ -0,0 +1,105 @@
+#include <bench.hpp>
+#include <sg14/retain_vector.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct object : sg14::reference_count<object> { long value { }; };
+
+/* Appends count copies of item to an empty vector without reserving, so the
+ * time is dominated by reallocation once the vector outgrows the caches.
+ */
+template <class Vector, class Item>
+void grow (
+  bench::recorder& out,
+  char const* name,
+  std::size_t count,
+  Item const& item
+) {
+  auto result = bench::measure([&] {
+    Vector items;
+    for (std::size_t idx = 0; idx < count; ++idx) { items.push_back(item); }
+    bench::do_not_optimize(items.data());
+  });
+  out.record("retain_vector", name, 1, count, result);
+}
+
+/* A single reallocation of count elements, the part of growth that
+ * relocation replaces.
+ */
+template <class Vector, class Item>
+void reallocate (
+  bench::recorder& out,
+  char const* name,
+  std::size_t count,
+  Item const& item
+) {
+  Vector items;
+  items.reserve(count);
+  for (std::size_t idx = 0; idx < count; ++idx) { items.push_back(item); }
+  auto result = bench::measure([&] {
+    items.reserve(2 * count);
+    bench::do_not_optimize(items.data());
+  });
+  out.record("retain_vector", name, 1, count, result);
+}
+
+template <class Vector, class Item>
+void erase_front (
+  bench::recorder& out,
+  char const* name,
+  std::size_t count,
+  Item const& item
+) {
+  Vector items;
+  for (std::size_t idx = 0; idx < count; ++idx) { items.push_back(item); }
+  auto result = bench::measure([&] {
+    for (std::size_t idx = 0; idx < count; ++idx) { items.erase(items.begin()); }
+    bench::do_not_optimize(items.data());
+  });
+  out.record("retain_vector", name, 1, count, result);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  bench::recorder out { argc, argv };
+  auto const count = bench::iterations(argc, argv, 1 << 23);
+  sg14::retain_ptr<object> item { new object };
+  auto shared = std::make_shared<object>();
+
+  { /* Warm up the allocator so the first entry is not penalized. */
+    std::vector<object*> warm;
+    for (std::size_t idx = 0; idx < count; ++idx) { warm.push_back(item.get()); }
+    bench::do_not_optimize(warm.data());
+  }
+
+  grow<sg14::retain_vector<object>>(out, "grow, retain_vector", count, item);
+  grow<std::vector<sg14::retain_ptr<object>>>(out, "grow, std::vector<retain_ptr>", count, item);
+  grow<std::vector<std::shared_ptr<object>>>(out, "grow, std::vector<shared_ptr>", count, shared);
+  grow<std::vector<object*>>(out, "grow, std::vector<T*>", count, item.get());
+
+  reallocate<sg14::retain_vector<object>>(out, "reallocate, retain_vector", count, item);
+  reallocate<std::vector<sg14::retain_ptr<object>>>(
+    out,
+    "reallocate, std::vector<retain_ptr>",
+    count,
+    item);
+  reallocate<std::vector<std::shared_ptr<object>>>(
+    out,
+    "reallocate, std::vector<shared_ptr>",
+    count,
+    shared);
+  reallocate<std::vector<object*>>(out, "reallocate, std::vector<T*>", count, item.get());
+
+  auto const erased = std::min<std::size_t>(count, 1 << 14);
+  erase_front<sg14::retain_vector<object>>(out, "erase front, retain_vector", erased, item);
+  erase_front<std::vector<sg14::retain_ptr<object>>>(
+    out,
+    "erase front, std::vector<retain_ptr>",
+    erased,
+    item);
+}
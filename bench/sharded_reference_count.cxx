@@ -0,0 +1,43 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+namespace {
+
+struct sharded : sg14::sharded_reference_count<sharded> { };
+struct atomic : sg14::atomic_reference_count<atomic> { };
+
+/* Every thread copies and releases the same object, as threads sharing a
+ * configuration or a module handle would.
+ */
+template <class Ptr>
+void shared_copies (
+  bench::recorder& out,
+  char const* name,
+  std::size_t threads,
+  std::size_t count,
+  Ptr const& ptr
+) {
+  auto result = bench::measure_threads(threads, [&] (std::size_t) {
+    for (std::size_t idx = 0; idx < count; ++idx) {
+      auto copy = ptr;
+      bench::do_not_optimize(copy);
+    }
+  });
+  out.record("sharded_reference_count", name, threads, count, result);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  bench::recorder out { argc, argv };
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  sg14::retain_ptr<sharded> sharded_ptr { new sharded };
+  sg14::retain_ptr<atomic> atomic_ptr { new atomic };
+
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    shared_copies(out, "copy/release, sharded", threads, count, sharded_ptr);
+    shared_copies(out, "copy/release, atomic", threads, count, atomic_ptr);
+  }
+  sg14::switch_to_atomic(sharded_ptr);
+  shared_copies(out, "copy/release, sharded after switch", 1, count, sharded_ptr);
+}
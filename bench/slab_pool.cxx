@@ -0,0 +1,74 @@
+#include <bench.hpp>
+#include <sg14/slab_pool.hpp>
+
+namespace {
+
+struct message : sg14::atomic_reference_count<message> {
+  std::size_t id;
+  char payload[40];
+};
+
+struct pooled_message : sg14::atomic_reference_count<pooled_message>, sg14::pooled {
+  std::size_t id;
+  char payload[40];
+};
+
+struct plain_message {
+  std::size_t id;
+  char payload[40];
+};
+
+constexpr std::size_t batch = 256;
+
+template <class Make>
+void churn (char const* name, std::size_t threads, std::size_t count, Make make) {
+  auto elapsed = bench::run_threads(threads, [&] (std::size_t) {
+    std::vector<decltype(make())> live(batch);
+    for (std::size_t i = 0; i < count; ++i) {
+      live[i % batch] = make();
+    }
+  });
+  bench::report("slab_pool", name, threads, count, elapsed);
+}
+
+/* Producers allocate, a consumer on another thread releases: every free is
+ * a cross-thread free.
+ */
+template <class Make>
+void handoff (char const* name, std::size_t count, Make make) {
+  using pointer = decltype(make());
+  std::vector<pointer> queue(count);
+  std::atomic<std::size_t> produced { 0 };
+  auto elapsed = bench::run_threads(2, [&] (std::size_t idx) {
+    if (idx == 0) {
+      for (std::size_t i = 0; i < count; ++i) {
+        queue[i] = make();
+        produced.store(i + 1, std::memory_order_release);
+      }
+      return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      while (produced.load(std::memory_order_acquire) <= i) { std::this_thread::yield(); }
+      queue[i] = nullptr;
+    }
+  });
+  bench::report("slab_pool", name, 2, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 21);
+  auto make_plain = [] { return sg14::make_retained<message>(); };
+  auto make_pooled = [] { return sg14::make_retained<pooled_message>(); };
+  auto make_shared = [] {
+    return std::allocate_shared<plain_message>(sg14::slab_allocator<plain_message> { });
+  };
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    churn("new/delete", threads, count, make_plain);
+    churn("pooled", threads, count, make_pooled);
+    churn("allocate_shared (slab_allocator)", threads, count, make_shared);
+  }
+  handoff("cross-thread new/delete", count, make_plain);
+  handoff("cross-thread pooled", count, make_pooled);
+}
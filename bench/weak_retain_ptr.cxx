@@ -0,0 +1,36 @@
+#include <bench.hpp>
+#include <sg14/memory.hpp>
+
+#include <memory>
+
+namespace {
+
+struct local_entry : sg14::weak_reference_count<local_entry> { long value { }; };
+struct atomic_entry : sg14::atomic_weak_reference_count<atomic_entry> { long value { }; };
+struct plain_entry { long value { }; };
+
+template <class Weak>
+void lock (char const* name, std::size_t threads, std::size_t count, Weak const& weak) {
+  auto elapsed = bench::run_threads(threads, [&] (std::size_t) {
+    for (std::size_t i = 0; i < count; ++i) {
+      auto locked = weak.lock();
+      bench::do_not_optimize(locked);
+    }
+  });
+  bench::report("weak_retain_ptr", name, threads, count, elapsed);
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  auto const count = bench::iterations(argc, argv, 1 << 22);
+  sg14::retain_ptr<local_entry> local { new local_entry };
+  sg14::retain_ptr<atomic_entry> atomic { new atomic_entry };
+  auto shared = std::make_shared<plain_entry>();
+
+  lock("lock, weak_reference_count", 1, count, sg14::weak_retain_ptr<local_entry> { local });
+  for (std::size_t threads = 1; threads <= bench::max_threads(); threads *= 2) {
+    lock("lock, atomic_weak_reference_count", threads, count, sg14::weak_retain_ptr<atomic_entry> { atomic });
+    lock("lock, std::weak_ptr", threads, count, std::weak_ptr<plain_entry> { shared });
+  }
+}
@@ -0,0 +1,277 @@
+#ifndef SG14_CYCLE_DETECTOR_HPP
+#define SG14_CYCLE_DETECTOR_HPP
+
+#include <sg14/instrumented.hpp>
+
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
+
+/* Objects deriving from tracked<T> are registered while they live when
+ * SG14_RETAIN_TRACKING is defined to 1. It is off by default and does not
+ * follow NDEBUG: it changes the layout of every tracked type, so it has to
+ * be set for the whole program, and translation units built with different
+ * assertion settings would otherwise violate the one definition rule. Pass
+ * tracked<T, true> to track a type regardless of the macro.
+ */
+#ifndef SG14_RETAIN_TRACKING
+  #define SG14_RETAIN_TRACKING 0
+#endif
+
+namespace sg14 {
+
+/* Opt-in description of the retain_ptr edges leaving a T. Specializations
+ * provide
+ *
+ *   template <class Visitor>
+ *   static void traverse (T const& object, Visitor& visit);
+ *
+ * calling visit(member) for every retain_ptr member. Objects without one are
+ * assumed to hold references the scan cannot see, so they are never the
+ * cause of a reported leak.
+ */
+template <class T> struct retain_traversal { };
+
+namespace impl {
+
+struct tracked_node;
+
+struct edge_collector final {
+  template <class U, class R>
+  void operator () (retain_ptr<U, R> const& ptr);
+
+  std::vector<tracked_node const*> targets;
+};
+
+template <class T>
+using has_traversal = decltype(retain_traversal<T>::traverse(
+  declval<T const&>(),
+  declval<edge_collector&>()));
+
+struct tracked_node {
+  struct descriptor {
+    std::string (*name)();
+    std::size_t size;
+    void const* (*object)(tracked_node const*);
+    long (*use_count)(tracked_node const*);
+    void (*traverse)(tracked_node const*, edge_collector&);
+  };
+
+  tracked_node (descriptor const* type) noexcept;
+  tracked_node (tracked_node const& that) noexcept : tracked_node { that.type } { }
+  tracked_node& operator = (tracked_node const&) noexcept { return *this; }
+  ~tracked_node ();
+
+  descriptor const* const type;
+  tracked_node* prev { nullptr };
+  tracked_node* next { nullptr };
+};
+
+/* Intrusive list of every tracked object. It is never destroyed, so objects
+ * with static storage duration may still unregister during exit.
+ */
+struct tracking_registry final {
+  static tracking_registry& instance () {
+    static auto registry = new tracking_registry;
+    return *registry;
+  }
+
+  void insert (tracked_node* node) {
+    std::lock_guard<std::mutex> lock { this->mutex };
+    node->prev = &this->head;
+    node->next = this->head.next;
+    this->head.next->prev = node;
+    this->head.next = node;
+    ++this->count;
+  }
+
+  void erase (tracked_node* node) {
+    std::lock_guard<std::mutex> lock { this->mutex };
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    --this->count;
+  }
+
+  std::mutex mutex;
+  tracked_node head { nullptr };
+  std::size_t count { 0 };
+
+private:
+  tracking_registry () noexcept { this->head.prev = this->head.next = &this->head; }
+};
+
+inline tracked_node::tracked_node (descriptor const* type) noexcept : type { type } {
+  if (type) { tracking_registry::instance().insert(this); }
+}
+
+inline tracked_node::~tracked_node () {
+  if (this->type) { tracking_registry::instance().erase(this); }
+}
+
+} /* namespace impl */
+
+/* Registers the derived T with the leak and cycle detector for as long as
+ * it lives. With Enabled false it is an empty base and costs nothing.
+ */
+template <class T, bool Enabled=SG14_RETAIN_TRACKING>
+struct tracked : private impl::tracked_node {
+  friend struct impl::edge_collector;
+protected:
+  tracked () noexcept : impl::tracked_node { &descriptor } { }
+
+private:
+  static impl::tracked_node::descriptor const descriptor;
+};
+
+template <class T>
+struct tracked<T, false> {
+protected:
+  tracked () noexcept = default;
+};
+
+template <class T, bool Enabled>
+impl::tracked_node::descriptor const tracked<T, Enabled>::descriptor {
+  [] { return impl::type_name(typeid(T)); },
+  sizeof(T),
+  [] (impl::tracked_node const* node) -> void const* {
+    return static_cast<T const*>(static_cast<tracked const*>(node));
+  },
+  [] (impl::tracked_node const* node) -> long {
+    auto object = static_cast<T const*>(static_cast<tracked const*>(node));
+    return retain_traits<T>::use_count(const_cast<T*>(object));
+  },
+  [] (impl::tracked_node const* node, impl::edge_collector& collector) {
+    if constexpr (is_detected<impl::has_traversal, T>::value) {
+      auto object = static_cast<T const*>(static_cast<tracked const*>(node));
+      retain_traversal<T>::traverse(*object, collector);
+    }
+  }
+};
+
+template <class U, class R>
+void impl::edge_collector::operator () (retain_ptr<U, R> const& ptr) {
+  if constexpr (std::is_base_of_v<tracked<U, true>, U>) {
+    if (ptr) { this->targets.push_back(static_cast<tracked<U, true> const*>(ptr.get())); }
+  }
+}
+
+struct leaked_object {
+  std::string type;
+  std::size_t size;
+  void const* address;
+  long use_count;
+};
+
+/* A group of objects kept alive only by references among themselves. */
+struct leaked_cycle {
+  std::vector<leaked_object> objects;
+  std::size_t bytes;
+};
+
+inline std::size_t tracked_object_count () {
+  auto& registry = impl::tracking_registry::instance();
+  std::lock_guard<std::mutex> lock { registry.mutex };
+  return registry.count;
+}
+
+/* Trial deletion over every tracked object: each edge found by
+ * retain_traversal is subtracted from its target's use_count, whatever is
+ * still referenced from outside is marked live along with everything it
+ * reaches, and the rest is reported grouped into connected components.
+ * Tracked objects must not be mutated by other threads during the scan.
+ */
+inline std::vector<leaked_cycle> find_leaked_cycles () {
+  auto& registry = impl::tracking_registry::instance();
+  std::lock_guard<std::mutex> lock { registry.mutex };
+
+  std::vector<impl::tracked_node const*> nodes;
+  std::unordered_map<impl::tracked_node const*, std::size_t> index;
+  for (auto node = registry.head.next; node != &registry.head; node = node->next) {
+    index.emplace(node, nodes.size());
+    nodes.push_back(node);
+  }
+
+  std::vector<long> counts(nodes.size());
+  std::vector<std::vector<std::size_t>> edges(nodes.size());
+  for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+    counts[idx] = nodes[idx]->type->use_count(nodes[idx]);
+  }
+  for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+    impl::edge_collector collector;
+    nodes[idx]->type->traverse(nodes[idx], collector);
+    for (auto target : collector.targets) {
+      auto found = index.find(target);
+      if (found == index.end()) { continue; }
+      edges[idx].push_back(found->second);
+      --counts[found->second];
+    }
+  }
+
+  std::vector<bool> live(nodes.size(), false);
+  std::vector<std::size_t> pending;
+  for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+    if (counts[idx] > 0) {
+      live[idx] = true;
+      pending.push_back(idx);
+    }
+  }
+  while (not pending.empty()) {
+    auto idx = pending.back();
+    pending.pop_back();
+    for (auto target : edges[idx]) {
+      if (live[target]) { continue; }
+      live[target] = true;
+      pending.push_back(target);
+    }
+  }
+
+  std::vector<std::size_t> parent(nodes.size());
+  std::iota(parent.begin(), parent.end(), std::size_t { 0 });
+  auto root = [&parent] (std::size_t idx) {
+    while (parent[idx] != idx) { idx = parent[idx] = parent[parent[idx]]; }
+    return idx;
+  };
+  for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+    if (live[idx]) { continue; }
+    for (auto target : edges[idx]) { parent[root(target)] = root(idx); }
+  }
+
+  std::vector<leaked_cycle> cycles;
+  std::unordered_map<std::size_t, std::size_t> groups;
+  for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+    if (live[idx]) { continue; }
+    auto group = groups.emplace(root(idx), cycles.size());
+    if (group.second) { cycles.push_back(leaked_cycle { { }, 0 }); }
+    auto& cycle = cycles[group.first->second];
+    auto type = nodes[idx]->type;
+    cycle.objects.push_back(leaked_object {
+      type->name(),
+      type->size,
+      type->object(nodes[idx]),
+      type->use_count(nodes[idx])
+    });
+    cycle.bytes += type->size;
+  }
+  return cycles;
+}
+
+inline std::size_t report_leaked_cycles (std::ostream& out) {
+  auto cycles = find_leaked_cycles();
+  for (std::size_t idx = 0; idx < cycles.size(); ++idx) {
+    auto& cycle = cycles[idx];
+    out << "leaked cycle " << idx << ": "
+        << cycle.objects.size() << " objects, "
+        << cycle.bytes << " bytes\n";
+    for (auto& object : cycle.objects) {
+      out << "  " << object.type
+          << " at " << object.address
+          << " (" << object.size << " bytes, use_count "
+          << object.use_count << ")\n";
+    }
+  }
+  return cycles.size();
+}
+
+} /* namespace sg14 */
+
+#endif /* SG14_CYCLE_DETECTOR_HPP */
@@ -0,0 +1,266 @@
+#ifndef SG14_HAZARD_POINTER_HPP
+#define SG14_HAZARD_POINTER_HPP
+
+#include <sg14/memory.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace sg14 {
+namespace impl {
+
+struct hazard_record final {
+  std::atomic<void const*> pointer { nullptr };
+  std::atomic<bool> active { true };
+  hazard_record* next { nullptr };
+};
+
+/* Process wide hazard pointer domain. Records are never freed, only recycled,
+ * so scanning them needs no synchronization beyond the record list head.
+ * Each thread keeps a few records cached and its own list of retired
+ * objects; whatever is still protected when a thread exits is handed to the
+ * domain and picked up by the next scan.
+ */
+struct hazard_domain final {
+  using dispose_type = void (*)(void*);
+
+  struct retired_object {
+    void* object;
+    dispose_type dispose;
+  };
+
+  static hazard_domain& instance () {
+    static hazard_domain domain;
+    return domain;
+  }
+
+  hazard_record* acquire () {
+    auto& state = local();
+    if (state.cached) { return state.cache[--state.cached]; }
+    for (auto record = this->head.load(std::memory_order_acquire); record; record = record->next) {
+      if (record->active.load(std::memory_order_relaxed)) { continue; }
+      if (not record->active.exchange(true, std::memory_order_acquire)) {
+        return record;
+      }
+    }
+    auto record = new hazard_record;
+    record->next = this->head.load(std::memory_order_relaxed);
+    while (not this->head.compare_exchange_weak(
+      record->next,
+      record,
+      std::memory_order_release,
+      std::memory_order_relaxed)) { }
+    this->records.fetch_add(1, std::memory_order_relaxed);
+    return record;
+  }
+
+  void release (hazard_record* record) noexcept {
+    record->pointer.store(nullptr, std::memory_order_release);
+    auto& state = local();
+    if (state.cached < thread_state::capacity) {
+      state.cache[state.cached++] = record;
+      return;
+    }
+    record->active.store(false, std::memory_order_release);
+  }
+
+  void retire (void* object, dispose_type dispose) {
+    auto& list = local().retired;
+    list.push_back(retired_object { object, dispose });
+    auto threshold = std::max<std::size_t>(
+      64,
+      2 * this->records.load(std::memory_order_relaxed));
+    if (list.size() >= threshold) { this->scan(list); }
+  }
+
+  void reclaim () { this->scan(local().retired); }
+
+private:
+  struct thread_state {
+    static constexpr std::size_t capacity = 8;
+
+    ~thread_state () {
+      auto& domain = instance();
+      for (std::size_t idx = 0; idx < this->cached; ++idx) {
+        this->cache[idx]->active.store(false, std::memory_order_release);
+      }
+      domain.scan(this->retired);
+      std::lock_guard<std::mutex> lock { domain.mutex };
+      domain.orphans.insert(
+        domain.orphans.end(),
+        this->retired.begin(),
+        this->retired.end());
+    }
+
+    hazard_record* cache[capacity];
+    std::size_t cached { 0 };
+    std::vector<retired_object> retired;
+  };
+
+  static thread_state& local () {
+    thread_local thread_state state;
+    return state;
+  }
+
+  void scan (std::vector<retired_object>& list) {
+    {
+      std::lock_guard<std::mutex> lock { this->mutex };
+      list.insert(list.end(), this->orphans.begin(), this->orphans.end());
+      this->orphans.clear();
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::vector<void const*> hazards;
+    for (auto record = this->head.load(std::memory_order_acquire); record; record = record->next) {
+      if (auto ptr = record->pointer.load(std::memory_order_seq_cst)) {
+        hazards.push_back(ptr);
+      }
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    auto pending = std::move(list);
+    list.clear();
+    for (auto& item : pending) {
+      if (std::binary_search(hazards.begin(), hazards.end(), item.object)) {
+        list.push_back(item);
+        continue;
+      }
+      item.dispose(item.object);
+    }
+  }
+
+  std::atomic<hazard_record*> head { nullptr };
+  std::atomic<std::size_t> records { 0 };
+  std::mutex mutex;
+  std::vector<retired_object> orphans;
+};
+
+} /* namespace impl */
+
+/* Reclaims every object retired by the calling thread that is no longer
+ * protected by a hazard pointer.
+ */
+inline void hazard_pointer_reclaim () { impl::hazard_domain::instance().reclaim(); }
+
+template <class T, class R=retain_traits<T>> struct hazard_retain_ptr;
+
+/* A reader's protection of the object held by a hazard_retain_ptr. While the
+ * guard lives the object is kept alive by the slot's retired reference, so
+ * it may be dereferenced without touching its reference count, and retain()
+ * turns it into an owning retain_ptr with a single increment.
+ */
+template <class T, class R=retain_traits<T>>
+struct hazard_guard {
+  using value_type = retain_ptr<T, R>;
+  using traits_type = R;
+  using pointer = typename value_type::pointer;
+
+  hazard_guard (hazard_guard&& that) noexcept :
+    record { std::exchange(that.record, nullptr) },
+    ptr { std::exchange(that.ptr, pointer { }) }
+  { }
+
+  hazard_guard& operator = (hazard_guard&& that) noexcept {
+    hazard_guard(std::move(that)).swap(*this);
+    return *this;
+  }
+
+  ~hazard_guard () {
+    if (this->record) { impl::hazard_domain::instance().release(this->record); }
+  }
+
+  void swap (hazard_guard& that) noexcept {
+    using std::swap;
+    swap(this->record, that.record);
+    swap(this->ptr, that.ptr);
+  }
+
+  explicit operator bool () const noexcept { return this->get(); }
+  decltype(auto) operator * () const noexcept { return *this->get(); }
+  pointer operator -> () const noexcept { return this->get(); }
+  pointer get () const noexcept { return this->ptr; }
+
+  value_type retain () const { return value_type(this->ptr, retain_object); }
+
+private:
+  friend struct hazard_retain_ptr<T, R>;
+
+  hazard_guard (impl::hazard_record* record, pointer ptr) noexcept :
+    record { record },
+    ptr { ptr }
+  { }
+
+  impl::hazard_record* record;
+  pointer ptr;
+};
+
+/* Shared slot whose readers use hazard pointers instead of reference
+ * counting. Writers retire the slot's reference to the previous object, and
+ * it is only passed to traits_type::decrement once no reader protects it.
+ */
+template <class T, class R>
+struct hazard_retain_ptr {
+  using value_type = retain_ptr<T, R>;
+  using traits_type = R;
+  using pointer = typename value_type::pointer;
+  using guard_type = hazard_guard<T, R>;
+
+  static_assert(
+    std::is_pointer_v<pointer>,
+    "hazard_retain_ptr requires traits_type::pointer to be a raw pointer");
+
+  hazard_retain_ptr (value_type desired) noexcept : ptr { desired.detach() } { }
+  hazard_retain_ptr (nullptr_t) noexcept : hazard_retain_ptr { } { }
+  hazard_retain_ptr () noexcept = default;
+
+  hazard_retain_ptr (hazard_retain_ptr const&) = delete;
+  hazard_retain_ptr& operator = (hazard_retain_ptr const&) = delete;
+
+  ~hazard_retain_ptr () { retire(this->ptr.load(std::memory_order_acquire)); }
+
+  guard_type protect () const {
+    auto record = impl::hazard_domain::instance().acquire();
+    auto current = this->ptr.load(std::memory_order_relaxed);
+    while (true) {
+      record->pointer.store(object(current), std::memory_order_seq_cst);
+      auto latest = this->ptr.load(std::memory_order_seq_cst);
+      if (latest == current) { break; }
+      current = latest;
+    }
+    return guard_type(record, current);
+  }
+
+  value_type load () const { return this->protect().retain(); }
+
+  void store (value_type desired) {
+    retire(this->ptr.exchange(desired.detach(), std::memory_order_seq_cst));
+  }
+
+  /* Returns a new reference to the previous object; the slot's own
+   * reference is retired since readers may still be using it.
+   */
+  value_type exchange (value_type desired) {
+    auto replaced = this->ptr.exchange(desired.detach(), std::memory_order_seq_cst);
+    value_type previous { replaced, retain_object };
+    retire(replaced);
+    return previous;
+  }
+
+private:
+  static void const* object (pointer ptr) noexcept {
+    return const_cast<void const*>(static_cast<void const volatile*>(ptr));
+  }
+
+  static void retire (pointer ptr) {
+    if (not ptr) { return; }
+    impl::hazard_domain::instance().retire(
+      const_cast<void*>(object(ptr)),
+      [] (void* object) { traits_type::decrement(static_cast<pointer>(object)); });
+  }
+
+  std::atomic<pointer> ptr { nullptr };
+};
+
+} /* namespace sg14 */
+
+#endif /* SG14_HAZARD_POINTER_HPP */
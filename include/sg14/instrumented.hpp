@@ -0,0 +1,265 @@
+#ifndef SG14_INSTRUMENTED_HPP
+#define SG14_INSTRUMENTED_HPP
+
+#include <sg14/memory.hpp>
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#if __has_include(<cxxabi.h>)
+  #include <cxxabi.h>
+  #include <cstdlib>
+#endif
+
+/* Defining SG14_RETAIN_INSTRUMENTATION to 1 turns instrumentable_traits into
+ * instrumented_retain_traits. Left at 0 it names the underlying traits, so
+ * the generated code is exactly that of the uninstrumented pointer. The
+ * macro changes types, so it must be set for the whole program (e.g. as a
+ * compile definition of every target); translation units that disagree
+ * violate the one definition rule. Code that cannot guarantee this should
+ * pass the Enabled argument of instrumentable_traits explicitly.
+ */
+#ifndef SG14_RETAIN_INSTRUMENTATION
+  #define SG14_RETAIN_INSTRUMENTATION 0
+#endif
+
+namespace sg14 {
+namespace impl {
+
+/* One thread's counters for one type. Only the owning thread writes them,
+ * with plain relaxed loads and stores, so counting never contends; readers
+ * may see slightly stale values.
+ */
+struct retain_shard final {
+  static void bump (std::atomic<std::uint64_t>& counter, std::uint64_t n = 1) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  std::atomic<std::uint64_t> increments { 0 };
+  std::atomic<std::uint64_t> decrements { 0 };
+  std::atomic<std::uint64_t> releases { 0 };
+  std::atomic<long> peak { 0 };
+  retain_shard* next { nullptr };
+};
+
+/* Every instrumented type registers one record on first use. Records and
+ * shards live for the rest of the program, so counts survive thread exit.
+ */
+struct retain_type_record final {
+  explicit retain_type_record (std::string name) : name { std::move(name) } {
+    auto& head = list();
+    this->next = head.load(std::memory_order_relaxed);
+    while (not head.compare_exchange_weak(
+      this->next,
+      this,
+      std::memory_order_release,
+      std::memory_order_relaxed)) { }
+  }
+
+  static std::atomic<retain_type_record*>& list () noexcept {
+    static std::atomic<retain_type_record*> head { nullptr };
+    return head;
+  }
+
+  retain_shard* attach () {
+    auto shard = new retain_shard;
+    shard->next = this->shards.load(std::memory_order_relaxed);
+    while (not this->shards.compare_exchange_weak(
+      shard->next,
+      shard,
+      std::memory_order_release,
+      std::memory_order_relaxed)) { }
+    return shard;
+  }
+
+  std::string const name;
+  std::atomic<retain_shard*> shards { nullptr };
+  retain_type_record* next { nullptr };
+};
+
+inline std::string type_name (std::type_info const& info) {
+#if __has_include(<cxxabi.h>)
+  int status = 0;
+  auto demangled = abi::__cxa_demangle(info.name(), nullptr, nullptr, &status);
+  if (demangled) {
+    std::string name { demangled };
+    std::free(demangled);
+    return name;
+  }
+#endif
+  return info.name();
+}
+
+template <class T>
+retain_type_record& type_record () {
+  static retain_type_record record { type_name(typeid(T)) };
+  return record;
+}
+
+template <class T>
+retain_shard& local_shard () {
+  thread_local retain_shard* shard = type_record<T>().attach();
+  return *shard;
+}
+
+template <class R, class P>
+using has_release = decltype(R::release(declval<P>()));
+
+template <class R, class P>
+using has_dispose = decltype(R::dispose(declval<P>()));
+
+} /* namespace impl */
+
+/* Traits that count increments, decrements, final releases and the peak
+ * use_count of T in per-thread shards before forwarding to R, whose pointer
+ * type and default action they keep. Final releases are only seen when R
+ * provides release(ptr); the object is then handed to R::dispose(ptr) if R
+ * has one, and deleted otherwise, which is what retain_traits does. Without
+ * release(ptr), or without dispose(ptr) for a pointer that is not raw, the
+ * decrement is forwarded to R::decrement and the releases column stays at
+ * zero.
+ */
+template <class T, class R=retain_traits<T>>
+struct instrumented_retain_traits {
+  using pointer = detected_or_t<add_pointer_t<T>, impl::has_pointer, R>;
+  using default_action = detected_or_t<
+    adopt_object_t,
+    impl::has_default_action,
+    R
+  >;
+
+  static void increment (pointer ptr) noexcept {
+    R::increment(ptr);
+    counted(ptr, 1);
+  }
+
+  /* Counted as n increments. */
+  static void increment (pointer ptr, std::size_t n) noexcept {
+    impl::increment_n<R>(ptr, n);
+    counted(ptr, n);
+  }
+
+  static void decrement (pointer ptr) {
+    auto& shard = impl::local_shard<T>();
+    impl::retain_shard::bump(shard.decrements);
+    if constexpr (releases_here) {
+      if (not R::release(ptr)) { return; }
+      impl::retain_shard::bump(shard.releases);
+      dispose(ptr);
+    } else {
+      R::decrement(ptr);
+    }
+  }
+
+  template <class P = pointer, class S = R>
+  static auto use_count (P ptr) -> decltype(S::use_count(ptr)) {
+    return S::use_count(ptr);
+  }
+
+private:
+  static constexpr bool releases_here =
+    is_detected<impl::has_release, R, pointer>::value and
+    (is_detected<impl::has_dispose, R, pointer>::value or std::is_pointer_v<pointer>);
+
+  static void counted (pointer ptr, std::size_t n) noexcept {
+    auto& shard = impl::local_shard<T>();
+    impl::retain_shard::bump(shard.increments, n);
+    if constexpr (is_detected<impl::has_use_count, R, pointer>::value) {
+      long count = R::use_count(ptr);
+      if (count > shard.peak.load(std::memory_order_relaxed)) {
+        shard.peak.store(count, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  static void dispose (pointer ptr) {
+    if constexpr (is_detected<impl::has_dispose, R, pointer>::value) {
+      R::dispose(ptr);
+    } else {
+      delete ptr;
+    }
+  }
+};
+
+template <
+  class T,
+  class R=retain_traits<T>,
+  bool Enabled=SG14_RETAIN_INSTRUMENTATION
+> using instrumentable_traits = conditional_t<
+  Enabled,
+  instrumented_retain_traits<T, R>,
+  R
+>;
+
+struct retain_statistics {
+  std::string type;
+  std::uint64_t increments;
+  std::uint64_t decrements;
+  std::uint64_t releases;
+  long peak_use_count;
+};
+
+/* Sums every thread's shards, busiest types first. */
+inline std::vector<retain_statistics> retain_statistics_snapshot () {
+  std::vector<retain_statistics> result;
+  auto record = impl::retain_type_record::list().load(std::memory_order_acquire);
+  for (; record; record = record->next) {
+    retain_statistics entry { record->name, 0, 0, 0, 0 };
+    auto shard = record->shards.load(std::memory_order_acquire);
+    for (; shard; shard = shard->next) {
+      entry.increments += shard->increments.load(std::memory_order_relaxed);
+      entry.decrements += shard->decrements.load(std::memory_order_relaxed);
+      entry.releases += shard->releases.load(std::memory_order_relaxed);
+      entry.peak_use_count = std::max(
+        entry.peak_use_count,
+        shard->peak.load(std::memory_order_relaxed));
+    }
+    result.push_back(std::move(entry));
+  }
+  std::stable_sort(result.begin(), result.end(), [] (auto const& lhs, auto const& rhs) {
+    return lhs.increments + lhs.decrements > rhs.increments + rhs.decrements;
+  });
+  return result;
+}
+
+enum class statistics_format { table, json };
+
+inline void dump_retain_statistics (
+  std::ostream& out,
+  statistics_format format = statistics_format::table
+) {
+  auto snapshot = retain_statistics_snapshot();
+  if (format == statistics_format::table) {
+    out << "type\tincrements\tdecrements\treleases\tpeak_use_count\n";
+    for (auto& entry : snapshot) {
+      out << entry.type << '\t'
+          << entry.increments << '\t'
+          << entry.decrements << '\t'
+          << entry.releases << '\t'
+          << entry.peak_use_count << '\n';
+    }
+    return;
+  }
+  out << "{\"types\":[";
+  char const* separator = "";
+  for (auto& entry : snapshot) {
+    out << separator << "{\"type\":\"";
+    for (auto c : entry.type) {
+      if (c == '"' or c == '\\') { out << '\\'; }
+      out << c;
+    }
+    out << "\",\"increments\":" << entry.increments
+        << ",\"decrements\":" << entry.decrements
+        << ",\"releases\":" << entry.releases
+        << ",\"peak_use_count\":" << entry.peak_use_count << '}';
+    separator = ",";
+  }
+  out << "]}\n";
+}
+
+} /* namespace sg14 */
+
+#endif /* SG14_INSTRUMENTED_HPP */
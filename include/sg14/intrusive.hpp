@@ -0,0 +1,283 @@
+#ifndef SG14_INTRUSIVE_HPP
+#define SG14_INTRUSIVE_HPP
+
+#include <sg14/memory.hpp>
+
+#include <iterator>
+
+namespace sg14 {
+
+/* Hooks are mixins placed next to a reference count mixin. An object may
+ * sit in one container per hook, so an object that has to be on several
+ * queues at once derives from hooks with distinct tags. Copying an object
+ * never copies its membership.
+ */
+template <class Tag=void>
+struct list_hook {
+  template <class, class, class> friend struct retain_list;
+
+  bool is_linked () const noexcept { return this->next; }
+
+protected:
+  list_hook () noexcept = default;
+  list_hook (list_hook const&) noexcept { }
+  list_hook& operator = (list_hook const&) noexcept { return *this; }
+  ~list_hook () { assert(not this->is_linked()); }
+
+private:
+  list_hook* prev { nullptr };
+  list_hook* next { nullptr };
+};
+
+template <class Tag=void>
+struct mpsc_hook {
+  template <class, class, class> friend struct retain_mpsc_queue;
+
+protected:
+  mpsc_hook () noexcept = default;
+  mpsc_hook (mpsc_hook const&) noexcept { }
+  mpsc_hook& operator = (mpsc_hook const&) noexcept { return *this; }
+
+private:
+  std::atomic<mpsc_hook*> next { nullptr };
+};
+
+/* Doubly linked list threaded through list_hook<Tag>. Each linked object
+ * carries the reference that was detached from the retain_ptr pushed onto
+ * the list, and popping or erasing adopts it again, so linking allocates
+ * nothing and costs no reference count traffic. The list releases whatever
+ * is still linked when it is destroyed.
+ */
+template <class T, class Tag=void, class R=retain_traits<T>>
+struct retain_list {
+  using value_type = retain_ptr<T, R>;
+  using traits_type = R;
+  using pointer = typename value_type::pointer;
+  using hook_type = list_hook<Tag>;
+  using size_type = std::size_t;
+
+  static_assert(
+    std::is_pointer_v<pointer>,
+    "retain_list requires traits_type::pointer to be a raw pointer");
+
+  template <bool Const>
+  struct basic_iterator {
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = conditional_t<Const, T const, T>;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    basic_iterator () noexcept = default;
+    template <bool C, class=std::enable_if_t<Const and not C>>
+    basic_iterator (basic_iterator<C> const& that) noexcept :
+      node { that.node }
+    { }
+
+    reference operator * () const noexcept { return *object(this->node); }
+    pointer operator -> () const noexcept { return object(this->node); }
+
+    basic_iterator& operator ++ () noexcept { this->node = this->node->next; return *this; }
+    basic_iterator& operator -- () noexcept { this->node = this->node->prev; return *this; }
+
+    basic_iterator operator ++ (int) noexcept {
+      auto previous = *this;
+      ++*this;
+      return previous;
+    }
+
+    basic_iterator operator -- (int) noexcept {
+      auto previous = *this;
+      --*this;
+      return previous;
+    }
+
+    bool operator == (basic_iterator const& that) const noexcept { return this->node == that.node; }
+    bool operator != (basic_iterator const& that) const noexcept { return this->node != that.node; }
+
+  private:
+    template <bool> friend struct basic_iterator;
+    friend struct retain_list;
+    explicit basic_iterator (hook_type const* node) noexcept :
+      node { const_cast<hook_type*>(node) }
+    { }
+
+    hook_type* node { nullptr };
+  };
+
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  retain_list (retain_list&& that) noexcept : retain_list { } { this->splice(that); }
+  retain_list (retain_list const&) = delete;
+
+  retain_list () noexcept { this->head.prev = this->head.next = &this->head; }
+  ~retain_list () { this->clear(); }
+
+  retain_list& operator = (retain_list&& that) noexcept {
+    this->clear();
+    this->splice(that);
+    return *this;
+  }
+
+  retain_list& operator = (retain_list const&) = delete;
+
+  iterator begin () noexcept { return iterator(this->head.next); }
+  iterator end () noexcept { return iterator(&this->head); }
+  const_iterator begin () const noexcept { return const_iterator(this->head.next); }
+  const_iterator end () const noexcept { return const_iterator(&this->head); }
+
+  size_type size () const noexcept { return this->count; }
+  bool empty () const noexcept { return not this->count; }
+
+  pointer front () const noexcept { return this->empty() ? nullptr : object(this->head.next); }
+  pointer back () const noexcept { return this->empty() ? nullptr : object(this->head.prev); }
+
+  void push_front (value_type ptr) noexcept { this->link(this->head.next, std::move(ptr)); }
+  void push_back (value_type ptr) noexcept { this->link(&this->head, std::move(ptr)); }
+
+  /* Links ptr in front of position. */
+  iterator insert (const_iterator position, value_type ptr) noexcept {
+    return this->link(position.node, std::move(ptr));
+  }
+
+  value_type pop_front () noexcept {
+    return this->empty() ? value_type { } : this->unlink(this->head.next);
+  }
+
+  value_type pop_back () noexcept {
+    return this->empty() ? value_type { } : this->unlink(this->head.prev);
+  }
+
+  /* Unlinks an object that is linked into this list. */
+  value_type erase (pointer ptr) noexcept { return this->unlink(hook(ptr)); }
+
+  void clear () noexcept {
+    while (not this->empty()) { this->pop_front(); }
+  }
+
+  /* Moves every object of that to the end of this list. */
+  void splice (retain_list& that) noexcept {
+    if (that.empty()) { return; }
+    auto first = that.head.next;
+    auto last = that.head.prev;
+    that.head.prev = that.head.next = &that.head;
+    first->prev = this->head.prev;
+    last->next = &this->head;
+    this->head.prev->next = first;
+    this->head.prev = last;
+    this->count += std::exchange(that.count, 0);
+  }
+
+private:
+  static hook_type* hook (pointer ptr) noexcept { return static_cast<hook_type*>(ptr); }
+  static pointer object (hook_type* node) noexcept { return static_cast<pointer>(node); }
+
+  iterator link (hook_type* position, value_type ptr) noexcept {
+    assert(ptr);
+    auto node = hook(ptr.detach());
+    assert(not node->is_linked());
+    node->next = position;
+    node->prev = position->prev;
+    position->prev->next = node;
+    position->prev = node;
+    ++this->count;
+    return iterator(node);
+  }
+
+  value_type unlink (hook_type* node) noexcept {
+    assert(node->is_linked());
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+    --this->count;
+    return value_type(object(node), adopt_object);
+  }
+
+  struct sentinel final : hook_type {
+    ~sentinel () { this->next = nullptr; }
+  };
+
+  sentinel head;
+  size_type count { 0 };
+};
+
+/* Lock free multiple producer, single consumer queue threaded through
+ * mpsc_hook<Tag>, after Dmitry Vyukov's intrusive design. push never
+ * blocks or allocates and only the consumer may call pop. Like retain_list
+ * the queue carries the pushed references and hands them back on pop.
+ *
+ * pop can return null while a producer that has claimed the tail has not yet
+ * linked its object; the object becomes visible once that push completes.
+ */
+template <class T, class Tag=void, class R=retain_traits<T>>
+struct retain_mpsc_queue {
+  using value_type = retain_ptr<T, R>;
+  using traits_type = R;
+  using pointer = typename value_type::pointer;
+  using hook_type = mpsc_hook<Tag>;
+
+  static_assert(
+    std::is_pointer_v<pointer>,
+    "retain_mpsc_queue requires traits_type::pointer to be a raw pointer");
+
+  retain_mpsc_queue () noexcept = default;
+
+  retain_mpsc_queue (retain_mpsc_queue const&) = delete;
+  retain_mpsc_queue& operator = (retain_mpsc_queue const&) = delete;
+
+  ~retain_mpsc_queue () {
+    while (this->pop()) { }
+  }
+
+  void push (value_type ptr) noexcept {
+    assert(ptr);
+    this->enqueue(static_cast<hook_type*>(ptr.detach()));
+  }
+
+  value_type pop () noexcept {
+    auto tail = this->tail;
+    auto next = tail->next.load(std::memory_order_acquire);
+    if (tail == &this->stub) {
+      if (not next) { return nullptr; }
+      this->tail = tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      this->tail = next;
+      return adopt(tail);
+    }
+    if (tail != this->head.load(std::memory_order_acquire)) { return nullptr; }
+    this->enqueue(&this->stub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (not next) { return nullptr; }
+    this->tail = next;
+    return adopt(tail);
+  }
+
+  /* Only meaningful to the consumer. */
+  bool empty () const noexcept {
+    return this->tail == &this->stub and not this->stub.next.load(std::memory_order_acquire);
+  }
+
+private:
+  struct stub_hook final : hook_type { };
+
+  static value_type adopt (hook_type* node) noexcept {
+    return value_type(static_cast<pointer>(node), adopt_object);
+  }
+
+  void enqueue (hook_type* node) noexcept {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    auto previous = this->head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  stub_hook stub;
+  alignas(padded::alignment) std::atomic<hook_type*> head { &stub };
+  alignas(padded::alignment) hook_type* tail { &stub };
+};
+
+} /* namespace sg14 */
+
+#endif /* SG14_INTRUSIVE_HPP */
@@ -2,10 +2,34 @@
 #define SG14_MEMORY_HPP
 
 #include <type_traits>
+#include <algorithm>
 #include <functional>
 #include <utility>
 #include <memory>
 #include <atomic>
+#include <new>
+#include <limits>
+#include <exception>
+
+#include <cstdint>
+#include <cassert>
+
+#if defined(__linux__) && defined(__GLIBC__)
+  #include <sched.h>
+#endif
+
+/* Under Clang retain_ptr is trivial_abi: it is passed in registers, and
+ * __is_trivially_relocatable reports it. The attribute also means a
+ * retain_ptr argument is destroyed by the callee rather than the caller.
+ */
+#if defined(__has_cpp_attribute)
+  #if __has_cpp_attribute(clang::trivial_abi)
+    #define SG14_TRIVIAL_ABI [[clang::trivial_abi]]
+  #endif
+#endif
+#ifndef SG14_TRIVIAL_ABI
+  #define SG14_TRIVIAL_ABI
+#endif
 
 namespace sg14 {
 
@@ -71,6 +95,66 @@ using has_default_action = typename T::default_action;
 template <class T, class P>
 using has_use_count = decltype(T::use_count(std::declval<P>()));
 
+template <class T>
+using has_weak_header = typename T::weak_header_type;
+
+/* Objects counted by a weak mixin, whose counts live in front of them. */
+template <class T>
+using is_weak_counted = is_detected<has_weak_header, T>;
+
+/* Weak counted objects find their header from the most derived object.
+ * Only a polymorphic T can recover it once a U* has become a T*, since the
+ * T subobject need not sit at offset 0.
+ */
+template <class U, class T>
+using keeps_weak_header = std::disjunction<
+  std::negation<is_weak_counted<T>>,
+  std::is_polymorphic<T>,
+  is_same<std::remove_cv_t<U>, std::remove_cv_t<T>>
+>;
+
+template <class T, class P>
+using has_bulk_increment = decltype(T::increment(std::declval<P>(), std::size_t { }));
+
+/* Takes n references with a single R::increment(ptr, n) where R has one. */
+template <class R, class P>
+void increment_n (P ptr, std::size_t n) {
+  if constexpr (is_detected<has_bulk_increment, R, P>::value) {
+    if (n) { R::increment(ptr, n); }
+  } else {
+    while (n--) { R::increment(ptr); }
+  }
+}
+
+template <class T, class P>
+using has_bulk_release = decltype(T::release(std::declval<P>(), std::size_t { }));
+
+template <class T, class P>
+using has_bulk_decrement = decltype(T::decrement(std::declval<P>(), std::size_t { }));
+
+/* Drops n references and reports whether they were the last ones, with a
+ * single R::release(ptr, n) where R has one.
+ */
+template <class R, class P>
+bool release_n (P ptr, std::size_t n) {
+  if constexpr (is_detected<has_bulk_release, R, P>::value) {
+    return n and R::release(ptr, n);
+  } else {
+    bool last = false;
+    while (n--) { last = R::release(ptr); }
+    return last;
+  }
+}
+
+template <class R, class P>
+void decrement_n (P ptr, std::size_t n) {
+  if constexpr (is_detected<has_bulk_decrement, R, P>::value) {
+    if (n) { R::decrement(ptr, n); }
+  } else {
+    while (n--) { R::decrement(ptr); }
+  }
+}
+
 }} /* namespace sg14::impl */
 
 namespace sg14 {
@@ -80,22 +164,586 @@ using impl::is_detected;
 
 template <class> struct retain_traits;
 
+/* Whether a T may be moved to new storage by copying its bytes and then
+ * forgetting the source, without running a constructor or destructor. Types
+ * opt in by specializing it, as retain_ptr does.
+ */
+template <class T>
+struct is_trivially_relocatable : std::bool_constant<
+#if defined(__has_builtin)
+  #if __has_builtin(__is_trivially_relocatable)
+  __is_trivially_relocatable(T) or
+  #endif
+#endif
+  std::is_trivially_copyable_v<T>
+> { };
+
 template <class T>
-struct atomic_reference_count {
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+/* Layout policies for atomic_reference_count. compact keeps the count inline
+ * with the derived object's first members; padded gives it a cache line of
+ * its own so count traffic from other cores does not evict the object's
+ * fields from readers' caches, at the cost of over-aligning the object.
+ */
+struct compact final { };
+struct padded final { static constexpr std::size_t alignment = 64; };
+
+/* Overflow policies for the counting mixins, applied when a count reaches
+ * the immortal threshold of its type. saturating lets the object become
+ * immortal, leaking it rather than freeing it early; checked terminates.
+ */
+struct saturating final { };
+struct checked final { };
+
+/* Option of atomic_reference_count for types whose objects are often
+ * immortal. Immortal counts are otherwise still written, with the result of
+ * each read-modify-write telling them apart so mortal objects pay nothing
+ * extra; skip_immortal loads the count first and leaves immortal objects
+ * untouched, at the cost of that load for every object of the type.
+ */
+struct skip_immortal final { };
+
+namespace impl {
+
+/* immortalize sets an object's count to immortal::count. Every count from
+ * immortal::threshold up is treated as immortal, so increments and
+ * decrements already in flight at that point can neither overflow the
+ * count nor bring it back to zero.
+ */
+template <class Count>
+struct immortal final {
+  static constexpr Count count = std::numeric_limits<Count>::max() / 2;
+  static constexpr Count threshold = count / 2;
+};
+
+template <class T>
+using is_layout = std::disjunction<is_same<T, compact>, is_same<T, padded>>;
+
+template <class T>
+using is_overflow = std::disjunction<is_same<T, saturating>, is_same<T, checked>>;
+
+template <class T>
+using is_count = std::conjunction<
+  std::is_integral<T>,
+  std::negation<is_same<T, bool>>
+>;
+
+template <class Default, template <class> class Is, class... Options>
+struct select_option : identity<Default> { };
+
+template <class Default, template <class> class Is, class Option, class... Options>
+struct select_option<Default, Is, Option, Options...> : conditional_t<
+  Is<Option>::value,
+  identity<Option>,
+  select_option<Default, Is, Options...>
+> { };
+
+/* Options of the counting mixins, given in any order: a layout, an
+ * integral count type, an overflow policy and skip_immortal.
+ */
+template <class... Options>
+struct count_options final {
+  static_assert(
+    (... and (
+      is_layout<Options>::value or
+      is_count<Options>::value or
+      is_overflow<Options>::value or
+      is_same<Options, skip_immortal>::value)),
+    "counting mixin options are a layout, an integral count type, an overflow policy and skip_immortal");
+
+  using layout = typename select_option<compact, is_layout, Options...>::type;
+  using count_type = typename select_option<long, is_count, Options...>::type;
+  using overflow = typename select_option<saturating, is_overflow, Options...>::type;
+  static constexpr bool skips_immortal = (... or is_same<Options, skip_immortal>::value);
+
+  template <class V>
+  static void check (V value) noexcept {
+    if constexpr (is_same<overflow, checked>::value) {
+      if (value >= immortal<count_type>::threshold) { std::terminate(); }
+    }
+  }
+};
+
+template <class Count, class Layout>
+struct atomic_count_storage {
+  std::atomic<Count> count { 1 };
+};
+
+template <class Count>
+struct atomic_count_storage<Count, padded> {
+  alignas(padded::alignment) std::atomic<Count> count { 1 };
+  /* Tail padding of a base may hold derived members, so fill the line. */
+  char padding[padded::alignment - sizeof(std::atomic<Count>)];
+};
+
+} /* namespace impl */
+
+/* Options select the layout, the count type and the overflow policy, e.g.
+ * atomic_reference_count<node, std::uint32_t, checked>. The default is a
+ * compact, saturating long. A count type holds up to a quarter of its
+ * maximum value in references before the overflow policy applies.
+ */
+template <class T, class... Options>
+struct atomic_reference_count : private impl::atomic_count_storage<
+  typename impl::count_options<Options...>::count_type,
+  typename impl::count_options<Options...>::layout
+> {
   template <class> friend class retain_traits;
 protected:
   atomic_reference_count () = default;
-private:
-  std::atomic<long> count { 1 };
 };
 
-template <class T>
+template <class T, class... Options>
 struct reference_count {
+  static_assert(
+    is_same<typename impl::count_options<Options...>::layout, compact>::value,
+    "reference_count is never shared between cores and takes no layout");
   template <class> friend class retain_traits;
 protected:
   reference_count () = default;
 private:
-  long count { 1 };
+  typename impl::count_options<Options...>::count_type count { 1 };
+};
+
+namespace impl {
+
+struct biased_count;
+
+/* Per-thread record for biased reference counts. It is shared between the
+ * thread and every object biased towards it, and carries the queue of
+ * objects whose shared count went negative and need to be merged.
+ */
+struct biased_owner final {
+  static constexpr std::uintptr_t closed = 1;
+
+  static biased_owner* current () noexcept {
+    struct holder {
+      biased_owner* owner = new biased_owner;
+      ~holder () {
+        this->owner->drain(true);
+        this->owner->release();
+      }
+    };
+    thread_local holder instance;
+    return instance.owner;
+  }
+
+  void retain () noexcept { this->refs.fetch_add(1, std::memory_order_relaxed); }
+  void release () noexcept {
+    if (this->refs.fetch_sub(1, std::memory_order_release) != 1) { return; }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    delete this;
+  }
+
+  bool pending () const noexcept {
+    return this->head.load(std::memory_order_relaxed);
+  }
+
+  inline bool push (biased_count*) noexcept;
+  inline void drain (bool close) noexcept;
+
+private:
+  std::atomic<long> refs { 1 };
+  std::atomic<std::uintptr_t> head { 0 };
+};
+
+/* Biased reference count (Choi, Shull and Torrellas). The owning thread
+ * counts in `local` with plain loads and stores, every other thread uses the
+ * atomic `shared` count whose low bits flag the object as queued for, or
+ * already done with, merging. A negative `local` means the bias was given up.
+ */
+struct biased_count {
+  using dispose_type = void (*)(biased_count*);
+
+  static constexpr long queued = 1;
+  static constexpr long merged = 2;
+  static constexpr long unit = 4;
+
+  biased_count () noexcept : owner { biased_owner::current() } {
+    this->owner->retain();
+  }
+  biased_count (biased_count const&) noexcept : biased_count { } { }
+  biased_count& operator = (biased_count const&) noexcept { return *this; }
+  ~biased_count () { this->owner->release(); }
+
+  void increment (long n = 1) noexcept {
+    if (this->owner == biased_owner::current()) {
+      auto local = this->local.load(std::memory_order_relaxed);
+      if (local >= 0) {
+        this->local.store(local + n, std::memory_order_relaxed);
+        return;
+      }
+    }
+    this->shared.fetch_add(n * unit, std::memory_order_relaxed);
+  }
+
+  /* Returns true when the caller released the last reference. If the object
+   * has to be handed to its owner for merging, `dispose` is recorded so the
+   * owner can destroy it later.
+   */
+  bool decrement (dispose_type dispose) noexcept {
+    if (this->owner == biased_owner::current()) {
+      auto local = this->local.load(std::memory_order_relaxed);
+      if (local > 0) {
+        this->local.store(--local, std::memory_order_relaxed);
+        if (not local) { return this->merge(); }
+        if (this->owner->pending()) { this->owner->drain(false); }
+        return false;
+      }
+    }
+    auto value = this->shared.fetch_sub(unit, std::memory_order_acq_rel) - unit;
+    if (value & merged) { return not (value & queued) and not (value >> 2); }
+    if ((value >> 2) >= 0 or (value & queued)) { return false; }
+    auto previous = this->shared.fetch_or(queued, std::memory_order_acq_rel);
+    if (previous & queued) { return false; }
+    if (not (previous & merged)) {
+      this->dispose = dispose;
+      if (this->owner->push(this)) { return false; }
+    }
+    return this->settle();
+  }
+
+  long use_count () const noexcept {
+    auto local = this->local.load(std::memory_order_relaxed);
+    auto shared = this->shared.load(std::memory_order_acquire) >> 2;
+    return shared + (local > 0 ? local : 0);
+  }
+
+  /* Folds the local count into the shared count and drops the bias. Only
+   * the owner may call this, or any thread once the owner has exited.
+   */
+  bool merge () noexcept {
+    auto local = this->local.load(std::memory_order_relaxed);
+    this->local.store(-1, std::memory_order_relaxed);
+    auto delta = local * unit + merged;
+    auto value = this->shared.fetch_add(delta, std::memory_order_acq_rel) + delta;
+    return not (value & queued) and not (value >> 2);
+  }
+
+  bool settle () noexcept {
+    if (this->local.load(std::memory_order_relaxed) >= 0) { this->merge(); }
+    auto value = this->shared.fetch_and(~queued, std::memory_order_acq_rel);
+    return (value & merged) and not (value >> 2);
+  }
+
+  biased_owner* const owner;
+  std::atomic<long> local { 1 };
+  std::atomic<long> shared { 0 };
+  biased_count* next { nullptr };
+  dispose_type dispose { nullptr };
+};
+
+bool biased_owner::push (biased_count* node) noexcept {
+  auto head = this->head.load(std::memory_order_acquire);
+  do {
+    if (head == closed) { return false; }
+    node->next = reinterpret_cast<biased_count*>(head);
+  } while (not this->head.compare_exchange_weak(
+    head,
+    reinterpret_cast<std::uintptr_t>(node),
+    std::memory_order_release,
+    std::memory_order_acquire));
+  return true;
+}
+
+void biased_owner::drain (bool close) noexcept {
+  auto head = this->head.exchange(close ? closed : 0, std::memory_order_acq_rel);
+  if (head == closed) { return; }
+  auto node = reinterpret_cast<biased_count*>(head);
+  while (node) {
+    auto next = node->next;
+    if (node->settle()) { node->dispose(node); }
+    node = next;
+  }
+}
+
+} /* namespace impl */
+
+template <class T>
+struct biased_reference_count : private impl::biased_count {
+  template <class> friend class retain_traits;
+protected:
+  biased_reference_count () = default;
+};
+
+/* Merges every object queued for the calling thread. Owners also do this
+ * when they release a reference and on thread exit, so this is only needed
+ * by threads that rarely release biased objects themselves.
+ */
+inline void flush_biased_reference_counts () noexcept {
+  impl::biased_owner::current()->drain(false);
+}
+
+namespace impl {
+
+/* Index of the calling CPU, or of the calling thread where that is not
+ * available. glibc answers sched_getcpu from the thread's rseq area when
+ * the kernel supports it, so this is a plain load on current systems.
+ */
+inline std::size_t current_shard () noexcept {
+#if defined(__linux__) && defined(__GLIBC__)
+  if (auto cpu = sched_getcpu(); cpu >= 0) { return static_cast<std::size_t>(cpu); }
+#endif
+  static std::atomic<std::size_t> threads { 0 };
+  thread_local std::size_t const index = threads.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+/* Reference count split over per-CPU slots, after the kernel's percpu_ref.
+ * While sharded, increments and decrements touch only the slot of the
+ * current CPU, so the total is never known and the object cannot be freed.
+ * switch_to_atomic folds the slots into `central`, after which the count
+ * behaves like atomic_reference_count.
+ *
+ * Slots are offset by `bias` so they may go negative without reaching the
+ * `dead` bit that the switch sets in each folded slot. An operation that
+ * finds its slot dead undoes itself there and goes to `central` instead.
+ * `central` takes on `bias` as well before `folded` is published, so releases
+ * redirected before the fold completes cannot reach zero early.
+ */
+template <std::size_t Shards>
+struct sharded_count {
+  static constexpr long bias = 1L << 61;
+  static constexpr long dead = 1L << 62;
+
+  sharded_count () noexcept = default;
+  sharded_count (sharded_count const&) noexcept : sharded_count { } { }
+  sharded_count& operator = (sharded_count const&) noexcept { return *this; }
+
+  /* A dead slot was written after `bias` reached `central`; the fence
+   * makes that write visible before `central` is touched.
+   */
+  void increment (long n = 1) noexcept {
+    if (not this->folded.load(std::memory_order_acquire)) {
+      auto& slot = this->slot();
+      if (not (slot.fetch_add(n, std::memory_order_relaxed) & dead)) { return; }
+      slot.fetch_sub(n, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    this->central.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  bool decrement (long n = 1) noexcept {
+    if (not this->folded.load(std::memory_order_acquire)) {
+      auto& slot = this->slot();
+      if (not (slot.fetch_sub(n, std::memory_order_release) & dead)) { return false; }
+      slot.fetch_add(n, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    if (this->central.fetch_sub(n, std::memory_order_release) != n) { return false; }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+  }
+
+  /* The caller must hold a reference for the duration of the call. */
+  void switch_to_atomic () noexcept {
+    if (this->switching.exchange(true, std::memory_order_acq_rel)) { return; }
+    this->publish();
+    this->fold();
+  }
+
+  /* The two halves of switch_to_atomic, kept apart so tests can run
+   * releases in between. publish redirects new operations to `central`,
+   * fold moves what the slots counted there.
+   */
+  void publish () noexcept {
+    this->central.fetch_add(bias, std::memory_order_relaxed);
+    this->folded.store(true, std::memory_order_release);
+  }
+
+  void fold () noexcept {
+    long total = 0;
+    for (auto& slot : this->slots) {
+      total += slot.value.exchange(dead | bias, std::memory_order_acq_rel) - bias;
+    }
+    this->central.fetch_add(total - bias, std::memory_order_acq_rel);
+  }
+
+  bool sharded () const noexcept { return not this->folded.load(std::memory_order_acquire); }
+
+  long use_count () const noexcept {
+    auto count = this->central.load(std::memory_order_relaxed);
+    if (this->folded.load(std::memory_order_acquire)) { return count; }
+    for (auto& slot : this->slots) {
+      auto value = slot.value.load(std::memory_order_relaxed);
+      if (not (value & dead)) { count += value - bias; }
+    }
+    return count;
+  }
+
+private:
+  struct alignas(padded::alignment) cell {
+    std::atomic<long> value { bias };
+  };
+
+  std::atomic<long>& slot () noexcept {
+    return this->slots[current_shard() % Shards].value;
+  }
+
+  cell slots[Shards];
+  alignas(padded::alignment) std::atomic<long> central { 1 };
+  std::atomic<bool> folded { false };
+  std::atomic<bool> switching { false };
+};
+
+} /* namespace impl */
+
+/* Counts in per-CPU slots for objects shared by every thread, at the cost
+ * of a cache line per slot. The object lives until its owner calls
+ * switch_to_atomic and the references are then all released; an object
+ * that is never switched is never destroyed.
+ */
+template <class T, std::size_t Shards=16>
+struct sharded_reference_count : private impl::sharded_count<Shards> {
+  template <class> friend class retain_traits;
+protected:
+  sharded_reference_count () = default;
+};
+
+namespace impl {
+
+/* Counts of an object deriving from a weak mixin, kept in front of it in the
+ * same allocation. The strong references together hold one weak reference,
+ * dropped by the class operator delete once the object is destroyed, and
+ * the storage is returned when the last weak reference goes.
+ */
+template <bool Atomic>
+struct weak_header final {
+  using count_type = conditional_t<Atomic, std::atomic<long>, long>;
+
+  explicit weak_header (std::size_t alignment) noexcept : alignment { alignment } { }
+
+  static constexpr std::size_t offset (std::size_t alignment) noexcept {
+    auto const align = std::max<std::size_t>(alignment, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    return (sizeof(weak_header) + align - 1) / align * align;
+  }
+
+  static weak_header* of (void const* object) noexcept {
+    auto address = const_cast<char*>(static_cast<char const*>(object));
+    return reinterpret_cast<weak_header*>(address - sizeof(weak_header));
+  }
+
+  template <class T>
+  static weak_header* of (T* ptr) noexcept {
+    if constexpr (std::is_polymorphic_v<T>) {
+      return of(static_cast<void const*>(dynamic_cast<void const*>(ptr)));
+    } else { return of(static_cast<void const*>(ptr)); }
+  }
+
+  static void* allocate (std::size_t size, std::size_t alignment) {
+    auto const skip = offset(alignment);
+    auto block = alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+      ? ::operator new(size + skip, std::align_val_t { alignment })
+      : ::operator new(size + skip);
+    auto object = static_cast<char*>(block) + skip;
+    ::new (object - sizeof(weak_header)) weak_header { alignment };
+    return object;
+  }
+
+  void increment (long n = 1) noexcept {
+    if constexpr (Atomic) { this->strong.fetch_add(n, std::memory_order_relaxed); }
+    else { this->strong += n; }
+  }
+
+  bool release (long n = 1) noexcept {
+    if constexpr (Atomic) {
+      if (this->strong.fetch_sub(n, std::memory_order_release) != n) { return false; }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return true;
+    } else { return not (this->strong -= n); }
+  }
+
+  /* Takes a strong reference unless the object is already being destroyed. */
+  bool try_increment () noexcept {
+    if constexpr (Atomic) {
+      auto count = this->strong.load(std::memory_order_relaxed);
+      do { if (not count) { return false; } }
+      while (not this->strong.compare_exchange_weak(
+        count,
+        count + 1,
+        std::memory_order_acquire,
+        std::memory_order_relaxed));
+      return true;
+    } else {
+      if (not this->strong) { return false; }
+      ++this->strong;
+      return true;
+    }
+  }
+
+  long use_count () const noexcept {
+    if constexpr (Atomic) { return this->strong.load(std::memory_order_relaxed); }
+    else { return this->strong; }
+  }
+
+  void retain_weak () noexcept {
+    if constexpr (Atomic) { this->weak.fetch_add(1, std::memory_order_relaxed); }
+    else { ++this->weak; }
+  }
+
+  void release_weak () noexcept {
+    if constexpr (Atomic) {
+      if (this->weak.fetch_sub(1, std::memory_order_acq_rel) != 1) { return; }
+    } else if (--this->weak) { return; }
+    auto const alignment = this->alignment;
+    auto block = reinterpret_cast<char*>(this + 1) - offset(alignment);
+    this->~weak_header();
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+      ::operator delete(block, std::align_val_t { alignment });
+    } else { ::operator delete(block); }
+  }
+
+  count_type strong { 1 };
+  count_type weak { 1 };
+  std::size_t const alignment;
+};
+
+/* Class allocation functions of the weak mixins. delete runs after the
+ * destructor, so it only gives up the strong side's weak reference.
+ */
+template <bool Atomic>
+struct weak_storage {
+  static void* operator new (std::size_t size) {
+    return weak_header<Atomic>::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+  }
+
+  static void* operator new (std::size_t size, std::align_val_t align) {
+    return weak_header<Atomic>::allocate(size, static_cast<std::size_t>(align));
+  }
+
+  static void operator delete (void* object) noexcept {
+    weak_header<Atomic>::of(object)->release_weak();
+  }
+
+  static void operator delete (void* object, std::align_val_t) noexcept {
+    weak_header<Atomic>::of(object)->release_weak();
+  }
+};
+
+} /* namespace impl */
+
+/* Reference counts that also allow weak_retain_ptr. The counts live in a
+ * header in front of the object, placed there by the mixin's operator new,
+ * so objects must be allocated with new T (or make_retained); placement new,
+ * automatic storage, allocate_retained and slab_allocator leave no header.
+ * Unless T is polymorphic, retain_ptr must point at the most derived
+ * object, and does not convert to a retain_ptr to any of its bases.
+ */
+template <class T>
+struct weak_reference_count : impl::weak_storage<false> {
+  using weak_header_type = impl::weak_header<false>;
+  template <class> friend class retain_traits;
+protected:
+  weak_reference_count () = default;
+};
+
+template <class T>
+struct atomic_weak_reference_count : impl::weak_storage<true> {
+  using weak_header_type = impl::weak_header<true>;
+  template <class> friend class retain_traits;
+protected:
+  atomic_weak_reference_count () = default;
 };
 
 struct retain_object_t {  retain_object_t () noexcept = default; };
@@ -109,39 +757,299 @@ struct retain_traits final {
   template <class U>
   using enable_if_base = std::enable_if_t<std::is_base_of_v<U, T>>;
 
-  template <class U, class = enable_if_base<U>>
-  static void increment (atomic_reference_count<U>* ptr) noexcept {
-    ptr->count.fetch_add(1, std::memory_order_relaxed);
+  /* release(ptr) drops a reference without disposing of the object and
+   * returns true when it was the last one. decrement is release followed by
+   * delete, and other traits may pair release with their own disposal.
+   * Each is a single read-modify-write: an immortal count sits further above
+   * its threshold than references can take it, so the result alone shows
+   * that it is neither the last reference nor a count to saturate. Only
+   * skip_immortal types load the count first.
+   */
+  template <class U, class... O, class = enable_if_base<U>>
+  static void increment (atomic_reference_count<U, O...>* ptr) noexcept {
+    using options = impl::count_options<O...>;
+    using count_type = typename options::count_type;
+    if constexpr (options::skips_immortal) {
+      if (is_immortal(ptr)) { return; }
+    }
+    auto count = ptr->count.fetch_add(1, std::memory_order_relaxed);
+    if (count + 1 == impl::immortal<count_type>::threshold) { saturate(ptr); }
+  }
+
+  /* Takes n references at once. n at or past the immortal threshold of the
+   * count type is handed to the overflow policy instead of wrapping.
+   */
+  template <class U, class... O, class = enable_if_base<U>>
+  static void increment (atomic_reference_count<U, O...>* ptr, std::size_t n) noexcept {
+    using options = impl::count_options<O...>;
+    using count_type = typename options::count_type;
+    constexpr auto threshold = impl::immortal<count_type>::threshold;
+    if constexpr (options::skips_immortal) {
+      if (is_immortal(ptr)) { return; }
+    }
+    if (n >= static_cast<std::size_t>(threshold)) { return saturate(ptr); }
+    auto const delta = static_cast<count_type>(n);
+    auto count = ptr->count.fetch_add(delta, std::memory_order_relaxed);
+    if (count < threshold and count + delta >= threshold) { saturate(ptr); }
+  }
+
+  template <class U, class... O, class = enable_if_base<U>>
+  static void decrement (atomic_reference_count<U, O...>* ptr) noexcept {
+    if (release(ptr)) { delete static_cast<T*>(ptr); }
+  }
+
+  template <class U, class... O, class = enable_if_base<U>>
+  static bool release (atomic_reference_count<U, O...>* ptr) noexcept {
+    if constexpr (impl::count_options<O...>::skips_immortal) {
+      if (is_immortal(ptr)) { return false; }
+    }
+    if (ptr->count.fetch_sub(1, std::memory_order_release) != 1) {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+  }
+
+  /* Drops n references held by the caller with a single read-modify-write,
+   * as a flush of coalesced deferred releases does.
+   */
+  template <class U, class... O, class = enable_if_base<U>>
+  static void decrement (atomic_reference_count<U, O...>* ptr, std::size_t n) noexcept {
+    if (release(ptr, n)) { delete static_cast<T*>(ptr); }
+  }
+
+  template <class U, class... O, class = enable_if_base<U>>
+  static bool release (atomic_reference_count<U, O...>* ptr, std::size_t n) noexcept {
+    using options = impl::count_options<O...>;
+    using count_type = typename options::count_type;
+    if constexpr (options::skips_immortal) {
+      if (is_immortal(ptr)) { return false; }
+    }
+    auto const delta = static_cast<count_type>(n);
+    if (ptr->count.fetch_sub(delta, std::memory_order_release) != delta) {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
   }
 
+  template <class U, class... O, class = enable_if_base<U>>
+  static long use_count (atomic_reference_count<U, O...>* ptr) noexcept {
+    return static_cast<long>(ptr->count.load(std::memory_order_relaxed));
+  }
+
+  template <class U, class... O, class = enable_if_base<U>>
+  static void immortalize (atomic_reference_count<U, O...>* ptr) noexcept {
+    using count_type = typename impl::count_options<O...>::count_type;
+    ptr->count.store(impl::immortal<count_type>::count, std::memory_order_relaxed);
+  }
+
+  template <class U, class... O, class = enable_if_base<U>>
+  static bool is_immortal (atomic_reference_count<U, O...>* ptr) noexcept {
+    using count_type = typename impl::count_options<O...>::count_type;
+    return ptr->count.load(std::memory_order_relaxed) >= impl::immortal<count_type>::threshold;
+  }
+
+  template <class U, class... O, class = enable_if_base<U>>
+  static void increment (reference_count<U, O...>* ptr) noexcept {
+    if (is_immortal(ptr)) { return; }
+    impl::count_options<O...>::check(++ptr->count);
+  }
+  template <class U, class... O, class = enable_if_base<U>>
+  static void increment (reference_count<U, O...>* ptr, std::size_t n) noexcept {
+    using options = impl::count_options<O...>;
+    using count_type = typename options::count_type;
+    if (is_immortal(ptr)) { return; }
+    if (n >= static_cast<std::size_t>(impl::immortal<count_type>::threshold)) {
+      options::check(impl::immortal<count_type>::threshold);
+      return immortalize(ptr);
+    }
+    options::check(ptr->count += static_cast<count_type>(n));
+  }
+  template <class U, class... O, class = enable_if_base<U>>
+  static void decrement (reference_count<U, O...>* ptr) noexcept {
+    if (release(ptr)) { delete static_cast<T*>(ptr); }
+  }
+  template <class U, class... O, class = enable_if_base<U>>
+  static bool release (reference_count<U, O...>* ptr) noexcept {
+    return not is_immortal(ptr) and not --ptr->count;
+  }
+  template <class U, class... O, class = enable_if_base<U>>
+  static void decrement (reference_count<U, O...>* ptr, std::size_t n) noexcept {
+    if (release(ptr, n)) { delete static_cast<T*>(ptr); }
+  }
+  template <class U, class... O, class = enable_if_base<U>>
+  static bool release (reference_count<U, O...>* ptr, std::size_t n) noexcept {
+    using count_type = typename impl::count_options<O...>::count_type;
+    return not is_immortal(ptr) and not (ptr->count -= static_cast<count_type>(n));
+  }
+  template <class U, class... O, class = enable_if_base<U>>
+  static long use_count (reference_count<U, O...>* ptr) noexcept {
+    return static_cast<long>(ptr->count);
+  }
+  template <class U, class... O, class = enable_if_base<U>>
+  static void immortalize (reference_count<U, O...>* ptr) noexcept {
+    using count_type = typename impl::count_options<O...>::count_type;
+    ptr->count = impl::immortal<count_type>::count;
+  }
+  template <class U, class... O, class = enable_if_base<U>>
+  static bool is_immortal (reference_count<U, O...>* ptr) noexcept {
+    using count_type = typename impl::count_options<O...>::count_type;
+    return ptr->count >= impl::immortal<count_type>::threshold;
+  }
+
+  template <class U, class = enable_if_base<U>>
+  static void increment (biased_reference_count<U>* ptr) noexcept {
+    ptr->increment();
+  }
+  template <class U, class = enable_if_base<U>>
+  static void increment (biased_reference_count<U>* ptr, std::size_t n) noexcept {
+    ptr->increment(static_cast<long>(n));
+  }
+  template <class U, class = enable_if_base<U>>
+  static void decrement (biased_reference_count<U>* ptr) noexcept {
+    if (release(ptr)) { delete static_cast<T*>(ptr); }
+  }
   template <class U, class = enable_if_base<U>>
-  static void decrement (atomic_reference_count<U>* ptr) noexcept {
-    ptr->count.fetch_sub(1, std::memory_order_acq_rel);
-    if (not use_count(ptr)) { delete static_cast<T*>(ptr); }
+  static bool release (biased_reference_count<U>* ptr) noexcept {
+    return ptr->decrement(&dispose<U>);
+  }
+  template <class U, class = enable_if_base<U>>
+  static long use_count (biased_reference_count<U>* ptr) noexcept {
+    return ptr->use_count();
+  }
+
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static void increment (sharded_reference_count<U, N>* ptr) noexcept {
+    ptr->increment();
+  }
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static void increment (sharded_reference_count<U, N>* ptr, std::size_t n) noexcept {
+    ptr->increment(static_cast<long>(n));
+  }
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static void decrement (sharded_reference_count<U, N>* ptr) noexcept {
+    if (release(ptr)) { delete static_cast<T*>(ptr); }
+  }
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static bool release (sharded_reference_count<U, N>* ptr) noexcept {
+    return ptr->decrement();
+  }
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static void decrement (sharded_reference_count<U, N>* ptr, std::size_t n) noexcept {
+    if (release(ptr, n)) { delete static_cast<T*>(ptr); }
+  }
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static bool release (sharded_reference_count<U, N>* ptr, std::size_t n) noexcept {
+    return ptr->decrement(static_cast<long>(n));
+  }
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static long use_count (sharded_reference_count<U, N>* ptr) noexcept {
+    return ptr->use_count();
+  }
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static void switch_to_atomic (sharded_reference_count<U, N>* ptr) noexcept {
+    ptr->switch_to_atomic();
+  }
+  template <class U, std::size_t N, class = enable_if_base<U>>
+  static bool is_sharded (sharded_reference_count<U, N>* ptr) noexcept {
+    return ptr->sharded();
   }
 
   template <class U, class = enable_if_base<U>>
-  static long use_count (atomic_reference_count<U>* ptr) noexcept {
-    return ptr->count.load(std::memory_order_relaxed);
+  static void increment (weak_reference_count<U>* ptr) noexcept {
+    header(ptr)->increment();
+  }
+  template <class U, class = enable_if_base<U>>
+  static void increment (weak_reference_count<U>* ptr, std::size_t n) noexcept {
+    header(ptr)->increment(static_cast<long>(n));
+  }
+  template <class U, class = enable_if_base<U>>
+  static void decrement (weak_reference_count<U>* ptr) noexcept {
+    if (release(ptr)) { delete static_cast<T*>(ptr); }
+  }
+  template <class U, class = enable_if_base<U>>
+  static bool release (weak_reference_count<U>* ptr) noexcept {
+    return header(ptr)->release();
+  }
+  template <class U, class = enable_if_base<U>>
+  static void decrement (weak_reference_count<U>* ptr, std::size_t n) noexcept {
+    if (release(ptr, n)) { delete static_cast<T*>(ptr); }
+  }
+  template <class U, class = enable_if_base<U>>
+  static bool release (weak_reference_count<U>* ptr, std::size_t n) noexcept {
+    return header(ptr)->release(static_cast<long>(n));
+  }
+  template <class U, class = enable_if_base<U>>
+  static long use_count (weak_reference_count<U>* ptr) noexcept {
+    return header(ptr)->use_count();
   }
 
   template <class U, class = enable_if_base<U>>
-  static void increment (reference_count<U>* ptr) noexcept {
-    ++ptr->count;
+  static void increment (atomic_weak_reference_count<U>* ptr) noexcept {
+    header(ptr)->increment();
+  }
+  template <class U, class = enable_if_base<U>>
+  static void increment (atomic_weak_reference_count<U>* ptr, std::size_t n) noexcept {
+    header(ptr)->increment(static_cast<long>(n));
+  }
+  template <class U, class = enable_if_base<U>>
+  static void decrement (atomic_weak_reference_count<U>* ptr) noexcept {
+    if (release(ptr)) { delete static_cast<T*>(ptr); }
+  }
+  template <class U, class = enable_if_base<U>>
+  static bool release (atomic_weak_reference_count<U>* ptr) noexcept {
+    return header(ptr)->release();
   }
   template <class U, class = enable_if_base<U>>
-  static void decrement (reference_count<U>* ptr) noexcept {
-    --ptr->count;
-    if (not use_count(ptr)) { delete static_cast<T*>(ptr); }
+  static void decrement (atomic_weak_reference_count<U>* ptr, std::size_t n) noexcept {
+    if (release(ptr, n)) { delete static_cast<T*>(ptr); }
   }
   template <class U, class = enable_if_base<U>>
-  static long use_count (reference_count<U>* ptr) noexcept {
-    return ptr->count;
+  static bool release (atomic_weak_reference_count<U>* ptr, std::size_t n) noexcept {
+    return header(ptr)->release(static_cast<long>(n));
+  }
+  template <class U, class = enable_if_base<U>>
+  static long use_count (atomic_weak_reference_count<U>* ptr) noexcept {
+    return header(ptr)->use_count();
+  }
+
+private:
+  template <class U, class... O>
+  static void saturate (atomic_reference_count<U, O...>* ptr) noexcept {
+    using options = impl::count_options<O...>;
+    options::check(impl::immortal<typename options::count_type>::threshold);
+    immortalize(ptr);
+  }
+
+  template <class U>
+  static void dispose (impl::biased_count* ptr) noexcept {
+    delete static_cast<T*>(static_cast<biased_reference_count<U>*>(ptr));
+  }
+
+  template <class M>
+  static auto header (M* ptr) noexcept {
+    return M::weak_header_type::of(static_cast<T*>(ptr));
   }
 };
 
+namespace impl {
+
+/* Traits of a retain_ptr<U, R> converted to element type T. retain_traits<U>
+ * rebinds to retain_traits<T>; any other traits type is kept, on the
+ * assumption that it handles the whole hierarchy.
+ */
+template <class R, class T> struct rebind_traits : identity<R> { };
+template <class U, class T>
+struct rebind_traits<retain_traits<U>, T> : identity<retain_traits<T>> { };
+
+template <class R, class T>
+using rebind_traits_t = typename rebind_traits<R, T>::type;
+
+} /* namespace impl */
+
 template <class T, class R=retain_traits<T>>
-struct retain_ptr {
+struct SG14_TRIVIAL_ABI retain_ptr {
   using element_type = T;
   using traits_type = R;
 
@@ -166,6 +1074,17 @@ struct retain_ptr {
     CheckAction,
     "traits_type::default_action must be adopt_object_t or retain_object_t");
 
+  /* retain_ptr<U, S> converts when its pointer does, its traits rebind
+   * to traits_type and, for weak counted objects, the weak header can
+   * still be found from the converted pointer.
+   */
+  template <class U, class S>
+  static constexpr bool is_compatible = std::conjunction_v<
+    std::is_convertible<typename retain_ptr<U, S>::pointer, pointer>,
+    std::is_same<impl::rebind_traits_t<S, T>, traits_type>,
+    impl::keeps_weak_header<U, T>
+  >;
+
   static constexpr auto has_use_count = is_detected<
     impl::has_use_count,
     traits_type,
@@ -192,6 +1111,16 @@ struct retain_ptr {
     ptr { that.detach() }
   { }
 
+  template <class U, class S, class=std::enable_if_t<is_compatible<U, S>>>
+  retain_ptr (retain_ptr<U, S> const& that) :
+    retain_ptr { that.get(), retain_object }
+  { }
+
+  template <class U, class S, class=std::enable_if_t<is_compatible<U, S>>>
+  retain_ptr (retain_ptr<U, S>&& that) noexcept :
+    ptr { that.detach() }
+  { }
+
   retain_ptr () noexcept = default;
   ~retain_ptr () {
     if (*this) { traits_type::decrement(this->get()); }
@@ -207,6 +1136,18 @@ struct retain_ptr {
     return *this;
   }
 
+  template <class U, class S, class=std::enable_if_t<is_compatible<U, S>>>
+  retain_ptr& operator = (retain_ptr<U, S> const& that) {
+    retain_ptr(that).swap(*this);
+    return *this;
+  }
+
+  template <class U, class S, class=std::enable_if_t<is_compatible<U, S>>>
+  retain_ptr& operator = (retain_ptr<U, S>&& that) {
+    retain_ptr(std::move(that)).swap(*this);
+    return *this;
+  }
+
   retain_ptr& operator = (nullptr_t) noexcept { this->reset(); return *this; }
 
   void swap (retain_ptr& that) noexcept {
@@ -214,7 +1155,7 @@ struct retain_ptr {
     swap(this->ptr, that.ptr);
   }
 
-  explicit operator bool () const noexcept { return this->get(); }
+  explicit operator bool () const noexcept { return static_cast<bool>(this->get()); }
   decltype(auto) operator * () const noexcept { return *this->get(); }
   pointer operator -> () const noexcept { return this->get(); }
 
@@ -232,6 +1173,27 @@ struct retain_ptr {
     return ptr;
   }
 
+  /* Writes n copies to out, taking their references with one bulk
+   * increment when traits_type supports it. If writing a copy throws, the
+   * references not yet handed out are released again.
+   */
+  template <class OutputIt>
+  OutputIt clone_n (std::size_t n, OutputIt out) const {
+    auto ptr = this->get();
+    if (ptr) { impl::increment_n<traits_type>(ptr, n); }
+    try {
+      for (; n; ++out) {
+        retain_ptr item { ptr, adopt_object };
+        --n;
+        *out = std::move(item);
+      }
+    } catch (...) {
+      if (ptr) { impl::decrement_n<traits_type>(ptr, n); }
+      throw;
+    }
+    return out;
+  }
+
   void reset (pointer ptr, retain_object_t) {
     *this = retain_ptr(ptr, retain_object);
   }
@@ -240,7 +1202,9 @@ struct retain_ptr {
     *this = retain_ptr(ptr, adopt_object);
   }
 
-  void reset (pointer ptr) { *this = retain_ptr(ptr, default_action()); }
+  void reset (pointer ptr = pointer { }) {
+    *this = retain_ptr(ptr, default_action());
+  }
 
 private:
   pointer ptr { };
@@ -345,6 +1309,695 @@ bool operator < (nullptr_t, retain_ptr<T, R> const& rhs) noexcept {
   return std::less<>()(rhs.get(), nullptr);
 }
 
+template <class T, class... Args>
+retain_ptr<T> make_retained (Args&&... args) {
+  return retain_ptr<T>(new T(std::forward<Args>(args)...), adopt_object);
+}
+
+/* Makes the object live for the rest of the program: it is never destroyed.
+ * A default atomic_reference_count is still counted, it just cannot be
+ * freed; with skip_immortal, and for reference_count, copying and
+ * destroying retain_ptrs to it never writes to the count, so even an object
+ * with a non-atomic reference_count may then be shared between threads. It
+ * must be called before the object is shared.
+ */
+template <class T, class R>
+void immortalize (retain_ptr<T, R> const& ptr) noexcept {
+  if (ptr) { R::immortalize(ptr.get()); }
+}
+
+template <class T, class R>
+bool is_immortal (retain_ptr<T, R> const& ptr) noexcept {
+  return ptr and R::is_immortal(ptr.get());
+}
+
+/* Ends the sharded mode of an object counted by sharded_reference_count,
+ * like percpu_ref_kill without dropping a reference: from here on the
+ * object is destroyed when its last reference is released.
+ */
+template <class T, class R>
+void switch_to_atomic (retain_ptr<T, R> const& ptr) noexcept {
+  if (ptr) { R::switch_to_atomic(ptr.get()); }
+}
+
+/* Casts keep the source's traits, rebinding retain_traits<U> to
+ * retain_traits<T>. The rvalue forms hand the reference over instead of
+ * taking a new one; a failed dynamic_pointer_cast leaves its source intact.
+ */
+template <class T, class U, class R>
+auto static_pointer_cast (retain_ptr<U, R> const& ptr) {
+  static_assert(
+    impl::keeps_weak_header<U, T>::value,
+    "weak counted objects may only be cast to a polymorphic base");
+  using result = retain_ptr<T, impl::rebind_traits_t<R, T>>;
+  return result(static_cast<typename result::pointer>(ptr.get()), retain_object);
+}
+
+template <class T, class U, class R>
+auto static_pointer_cast (retain_ptr<U, R>&& ptr) noexcept {
+  static_assert(
+    impl::keeps_weak_header<U, T>::value,
+    "weak counted objects may only be cast to a polymorphic base");
+  using result = retain_ptr<T, impl::rebind_traits_t<R, T>>;
+  return result(static_cast<typename result::pointer>(ptr.detach()), adopt_object);
+}
+
+template <class T, class U, class R>
+auto dynamic_pointer_cast (retain_ptr<U, R> const& ptr) {
+  using result = retain_ptr<T, impl::rebind_traits_t<R, T>>;
+  return result(dynamic_cast<typename result::pointer>(ptr.get()), retain_object);
+}
+
+template <class T, class U, class R>
+auto dynamic_pointer_cast (retain_ptr<U, R>&& ptr) noexcept {
+  using result = retain_ptr<T, impl::rebind_traits_t<R, T>>;
+  auto cast = dynamic_cast<typename result::pointer>(ptr.get());
+  if (cast) { ptr.detach(); }
+  return result(cast, adopt_object);
+}
+
+template <class T, class U, class R>
+auto const_pointer_cast (retain_ptr<U, R> const& ptr) {
+  using result = retain_ptr<T, impl::rebind_traits_t<R, T>>;
+  return result(const_cast<typename result::pointer>(ptr.get()), retain_object);
+}
+
+template <class T, class U, class R>
+auto const_pointer_cast (retain_ptr<U, R>&& ptr) noexcept {
+  using result = retain_ptr<T, impl::rebind_traits_t<R, T>>;
+  return result(const_cast<typename result::pointer>(ptr.detach()), adopt_object);
+}
+
+template <class T, class U, class R>
+auto reinterpret_pointer_cast (retain_ptr<U, R> const& ptr) {
+  using result = retain_ptr<T, impl::rebind_traits_t<R, T>>;
+  return result(reinterpret_cast<typename result::pointer>(ptr.get()), retain_object);
+}
+
+template <class T, class U, class R>
+auto reinterpret_pointer_cast (retain_ptr<U, R>&& ptr) noexcept {
+  using result = retain_ptr<T, impl::rebind_traits_t<R, T>>;
+  return result(reinterpret_cast<typename result::pointer>(ptr.detach()), adopt_object);
+}
+
+/* Non-owning companion of retain_ptr for objects deriving from
+ * weak_reference_count or atomic_weak_reference_count. It keeps the object's
+ * storage and counts alive, never the object itself, and lock() yields a
+ * retain_ptr while the object still has strong references.
+ */
+template <class T, class R=retain_traits<T>>
+struct weak_retain_ptr {
+  using element_type = T;
+  using traits_type = R;
+  using value_type = retain_ptr<T, R>;
+  using pointer = typename value_type::pointer;
+  using header_type = typename T::weak_header_type;
+
+  weak_retain_ptr (value_type const& that) noexcept :
+    ptr { that.get() },
+    header { that ? header_type::of(that.get()) : nullptr }
+  { if (this->header) { this->header->retain_weak(); } }
+
+  weak_retain_ptr (weak_retain_ptr const& that) noexcept :
+    ptr { that.ptr },
+    header { that.header }
+  { if (this->header) { this->header->retain_weak(); } }
+
+  weak_retain_ptr (weak_retain_ptr&& that) noexcept :
+    ptr { std::exchange(that.ptr, pointer { }) },
+    header { std::exchange(that.header, nullptr) }
+  { }
+
+  weak_retain_ptr (nullptr_t) noexcept : weak_retain_ptr { } { }
+  weak_retain_ptr () noexcept = default;
+  ~weak_retain_ptr () {
+    if (this->header) { this->header->release_weak(); }
+  }
+
+  weak_retain_ptr& operator = (weak_retain_ptr const& that) noexcept {
+    weak_retain_ptr(that).swap(*this);
+    return *this;
+  }
+
+  weak_retain_ptr& operator = (weak_retain_ptr&& that) noexcept {
+    weak_retain_ptr(std::move(that)).swap(*this);
+    return *this;
+  }
+
+  weak_retain_ptr& operator = (value_type const& that) noexcept {
+    weak_retain_ptr(that).swap(*this);
+    return *this;
+  }
+
+  void swap (weak_retain_ptr& that) noexcept {
+    using std::swap;
+    swap(this->ptr, that.ptr);
+    swap(this->header, that.header);
+  }
+
+  void reset () noexcept { weak_retain_ptr().swap(*this); }
+
+  long use_count () const noexcept {
+    return this->header ? this->header->use_count() : 0;
+  }
+
+  bool expired () const noexcept { return not this->use_count(); }
+
+  value_type lock () const noexcept {
+    if (not this->header or not this->header->try_increment()) { return nullptr; }
+    return value_type(this->ptr, adopt_object);
+  }
+
+private:
+  pointer ptr { };
+  header_type* header { nullptr };
+};
+
+template <class T, class R>
+void swap (weak_retain_ptr<T, R>& lhs, weak_retain_ptr<T, R>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+/* Non-owning view of an object some retain_ptr keeps alive, for parameters
+ * of functions that only use the object for the duration of the call. It
+ * converts implicitly from retain_ptr, copies without touching the count,
+ * and retain() takes a reference when the callee does need to keep one.
+ * Like std::string_view it must not outlive what it was borrowed from.
+ */
+template <class T, class R=retain_traits<T>>
+struct borrowed_ptr {
+  using element_type = T;
+  using traits_type = R;
+  using value_type = retain_ptr<T, R>;
+  using pointer = typename value_type::pointer;
+
+  borrowed_ptr (value_type const& that) noexcept : ptr { that.get() } { }
+
+  template <
+    class U,
+    class S,
+    class=std::enable_if_t<value_type::template is_compatible<U, S>>
+  > borrowed_ptr (retain_ptr<U, S> const& that) noexcept :
+    ptr { that.get() }
+  { }
+
+  template <
+    class U,
+    class S,
+    class=std::enable_if_t<value_type::template is_compatible<U, S>>
+  > borrowed_ptr (borrowed_ptr<U, S> const& that) noexcept :
+    ptr { that.get() }
+  { }
+
+  /* For objects known to be alive some other way, such as `this`. */
+  explicit borrowed_ptr (pointer ptr) noexcept : ptr { ptr } { }
+
+  borrowed_ptr (nullptr_t) noexcept : borrowed_ptr { } { }
+  borrowed_ptr () noexcept = default;
+
+  explicit operator bool () const noexcept { return static_cast<bool>(this->get()); }
+  decltype(auto) operator * () const noexcept { return *this->get(); }
+  pointer operator -> () const noexcept { return this->get(); }
+
+  pointer get () const noexcept { return this->ptr; }
+
+  long use_count () const {
+    if constexpr (value_type::has_use_count) {
+      return this->get() ? traits_type::use_count(this->get()) : 0;
+    } else { return -1; }
+  }
+
+  value_type retain () const { return value_type(this->get(), retain_object); }
+
+private:
+  pointer ptr { };
+};
+
+template <class T, class R>
+bool operator == (borrowed_ptr<T, R> const& lhs, borrowed_ptr<T, R> const& rhs) noexcept {
+  return lhs.get() == rhs.get();
+}
+
+template <class T, class R>
+bool operator != (borrowed_ptr<T, R> const& lhs, borrowed_ptr<T, R> const& rhs) noexcept {
+  return lhs.get() != rhs.get();
+}
+
+template <class T, class R>
+bool operator == (borrowed_ptr<T, R> const& lhs, nullptr_t) noexcept {
+  return not lhs;
+}
+
+template <class T, class R>
+bool operator != (borrowed_ptr<T, R> const& lhs, nullptr_t) noexcept {
+  return bool(lhs);
+}
+
+/* Both pointers are their handles and nothing more: a moved from handle is
+ * null and its destructor does nothing, so moving the bytes is a move.
+ */
+template <class T, class R>
+struct is_trivially_relocatable<retain_ptr<T, R>> :
+  is_trivially_relocatable<typename retain_ptr<T, R>::pointer>
+{ };
+
+template <class T, class R>
+struct is_trivially_relocatable<weak_retain_ptr<T, R>> :
+  is_trivially_relocatable<typename weak_retain_ptr<T, R>::pointer>
+{ };
+
+namespace impl {
+
+template <class A, bool=std::is_empty_v<A> and not std::is_final_v<A>>
+struct allocator_storage : private A {
+  explicit allocator_storage (A const& alloc) noexcept : A { alloc } { }
+  A allocator () const noexcept { return *this; }
+};
+
+template <class A>
+struct allocator_storage<A, false> {
+  explicit allocator_storage (A const& alloc) noexcept : alloc { alloc } { }
+  A allocator () const noexcept { return this->alloc; }
+private:
+  A alloc;
+};
+
+/* The object actually created by allocate_retained: T followed by the
+ * allocator that has to release it, which takes no space when stateless.
+ */
+template <class T, class A>
+struct allocated_object final : T, allocator_storage<A> {
+  template <class... Args>
+  allocated_object (A const& alloc, Args&&... args) :
+    T(std::forward<Args>(args)...),
+    allocator_storage<A> { alloc }
+  { }
+};
+
+} /* namespace impl */
+
+/* Pointer type of allocated_retain_traits. It converts to T* only through
+ * get(), so an object that has to go back to its allocator cannot be adopted
+ * by a retain_ptr or borrowed_ptr with other traits, which would delete it.
+ */
+template <class T>
+struct allocated_pointer {
+  allocated_pointer (nullptr_t) noexcept { }
+  explicit allocated_pointer (T* ptr) noexcept : ptr { ptr } { }
+  allocated_pointer () noexcept = default;
+
+  explicit operator bool () const noexcept { return this->ptr; }
+  T& operator * () const noexcept { return *this->ptr; }
+  T* operator -> () const noexcept { return this->ptr; }
+
+  T* get () const noexcept { return this->ptr; }
+
+  friend bool operator == (allocated_pointer lhs, allocated_pointer rhs) noexcept {
+    return lhs.ptr == rhs.ptr;
+  }
+  friend bool operator != (allocated_pointer lhs, allocated_pointer rhs) noexcept {
+    return lhs.ptr != rhs.ptr;
+  }
+  friend bool operator < (allocated_pointer lhs, allocated_pointer rhs) noexcept {
+    return std::less<T*>()(lhs.ptr, rhs.ptr);
+  }
+  friend bool operator > (allocated_pointer lhs, allocated_pointer rhs) noexcept { return rhs < lhs; }
+  friend bool operator <= (allocated_pointer lhs, allocated_pointer rhs) noexcept { return not (rhs < lhs); }
+  friend bool operator >= (allocated_pointer lhs, allocated_pointer rhs) noexcept { return not (lhs < rhs); }
+
+private:
+  T* ptr { nullptr };
+};
+
+/* Traits for objects created by allocate_retained. The reference count is
+ * managed by R, but the last release destroys and deallocates the object
+ * through the allocator it was created with. The allocator is part of the
+ * retain_ptr type rather than stored as a type-erased deleter, so releasing
+ * costs no indirect call and objects carry no deleter, but the result does
+ * not convert to retain_ptr<T>.
+ */
+template <class T, class Alloc, class R=retain_traits<T>>
+struct allocated_retain_traits {
+  using pointer = allocated_pointer<T>;
+
+  static void increment (pointer ptr) noexcept { R::increment(ptr.get()); }
+  static void increment (pointer ptr, std::size_t n) noexcept {
+    impl::increment_n<R>(ptr.get(), n);
+  }
+
+  static void decrement (pointer ptr) {
+    if (R::release(ptr.get())) { dispose(ptr.get()); }
+  }
+
+  static void decrement (pointer ptr, std::size_t n) {
+    if (impl::release_n<R>(ptr.get(), n)) { dispose(ptr.get()); }
+  }
+
+  template <class P = pointer>
+  static auto use_count (P ptr) -> decltype(R::use_count(ptr.get())) {
+    return R::use_count(ptr.get());
+  }
+
+private:
+  static void dispose (T* ptr) {
+    auto object = static_cast<object_type*>(ptr);
+    allocator_type alloc { object->allocator() };
+    std::allocator_traits<allocator_type>::destroy(alloc, object);
+    std::allocator_traits<allocator_type>::deallocate(alloc, object, 1);
+  }
+
+  using object_type = impl::allocated_object<T, Alloc>;
+  using allocator_type = typename std::allocator_traits<Alloc>::template
+    rebind_alloc<object_type>;
+};
+
+template <class T, class Alloc, class... Args>
+retain_ptr<T, allocated_retain_traits<T, Alloc>> allocate_retained (
+  Alloc const& alloc,
+  Args&&... args
+) {
+  using object_type = impl::allocated_object<T, Alloc>;
+  using allocator_type = typename std::allocator_traits<Alloc>::template
+    rebind_alloc<object_type>;
+  using traits = std::allocator_traits<allocator_type>;
+  static_assert(
+    std::is_pointer_v<typename traits::pointer>,
+    "allocate_retained requires an allocator with raw pointers");
+  static_assert(
+    not impl::is_weak_counted<T>::value,
+    "weak counted objects must be created with new T or make_retained");
+
+  allocator_type rebound { alloc };
+  auto object = traits::allocate(rebound, 1);
+  try {
+    traits::construct(rebound, object, alloc, std::forward<Args>(args)...);
+  } catch (...) {
+    traits::deallocate(rebound, object, 1);
+    throw;
+  }
+  using result = retain_ptr<T, allocated_retain_traits<T, Alloc>>;
+  return result(typename result::pointer { static_cast<T*>(object) }, adopt_object);
+}
+
+/* Lock-free shared slot for a retain_ptr. The slot word packs the pointer
+ * together with a count of readers that are in the middle of acquiring it
+ * (a split reference count). Readers reserve a credit with a single fetch_add,
+ * which keeps the object alive until they have taken their own reference.
+ * Writers convert every outstanding credit into a real reference before the
+ * pointer is swapped out, so a reader that loses the race may release its
+ * credit through traits_type::decrement at any time afterwards.
+ *
+ * On 64-bit targets the pointer must fit in the low 48 bits, which excludes
+ * 5-level paging (LA57) and heaps that tag the high bits of pointers. Storing
+ * a pointer that does not fit calls std::terminate, since its bits would
+ * otherwise be taken for credits.
+ */
+template <class T, class R=retain_traits<T>>
+struct atomic_retain_ptr {
+  using value_type = retain_ptr<T, R>;
+  using element_type = typename value_type::element_type;
+  using traits_type = typename value_type::traits_type;
+  using pointer = typename value_type::pointer;
+
+  static_assert(
+    std::is_pointer_v<pointer>,
+    "atomic_retain_ptr requires traits_type::pointer to be a raw pointer");
+  static_assert(
+    sizeof(pointer) <= 8,
+    "atomic_retain_ptr packs pointers of at most 64 bits");
+
+private:
+  using word_type = std::uint64_t;
+
+  static constexpr int count_shift = sizeof(pointer) < 8 ? 32 : 48;
+  static constexpr word_type count_unit = word_type { 1 } << count_shift;
+  static constexpr word_type pointer_mask = count_unit - 1;
+
+public:
+  static constexpr bool is_always_lock_free =
+    std::atomic<word_type>::is_always_lock_free;
+
+  atomic_retain_ptr (value_type desired) noexcept :
+    word { pack(desired.detach()) }
+  { }
+
+  atomic_retain_ptr (nullptr_t) noexcept : atomic_retain_ptr { } { }
+  atomic_retain_ptr () noexcept = default;
+
+  atomic_retain_ptr (atomic_retain_ptr const&) = delete;
+  atomic_retain_ptr& operator = (atomic_retain_ptr const&) = delete;
+
+  ~atomic_retain_ptr () {
+    value_type { unpack(this->word.load(std::memory_order_acquire)), adopt_object };
+  }
+
+  void operator = (value_type desired) { this->store(std::move(desired)); }
+  operator value_type () const { return this->load(); }
+
+  bool is_lock_free () const noexcept { return this->word.is_lock_free(); }
+
+  value_type load () const {
+    pointer ptr;
+    this->replace(0, ptr, [] (pointer) { return false; });
+    return value_type(ptr, adopt_object);
+  }
+
+  void store (value_type desired) { this->exchange(std::move(desired)); }
+
+  value_type exchange (value_type desired) {
+    pointer ptr;
+    this->replace(pack(desired.get()), ptr, [] (pointer) { return true; });
+    desired.detach();
+    return value_type(ptr, adopt_object);
+  }
+
+  bool compare_exchange_strong (value_type& expected, value_type desired) {
+    auto const target = expected.get();
+    pointer ptr;
+    auto matches = [target] (pointer current) { return current == target; };
+    if (this->replace(pack(desired.get()), ptr, matches)) {
+      desired.detach();
+      value_type { ptr, adopt_object };
+      return true;
+    }
+    expected = value_type(ptr, adopt_object);
+    return false;
+  }
+
+  bool compare_exchange_weak (value_type& expected, value_type desired) {
+    return this->compare_exchange_strong(expected, std::move(desired));
+  }
+
+private:
+  static word_type pack (pointer ptr) noexcept {
+    auto bits = static_cast<word_type>(reinterpret_cast<std::uintptr_t>(ptr));
+    if (bits & ~pointer_mask) { std::terminate(); }
+    return bits;
+  }
+
+  static pointer unpack (word_type word) noexcept {
+    return reinterpret_cast<pointer>(
+      static_cast<std::uintptr_t>(word & pointer_mask));
+  }
+
+  static word_type credits (word_type word) noexcept {
+    return word >> count_shift;
+  }
+
+  /* Gives back the credit reserved with `current`. If the slot still holds
+   * ptr the credit is returned to the slot word, otherwise a writer has
+   * already converted it into a reference that must be dropped.
+   */
+  void release (pointer ptr, word_type current) const {
+    while (unpack(current) == ptr and credits(current)) {
+      if (this->word.compare_exchange_weak(
+        current,
+        current - count_unit,
+        std::memory_order_release,
+        std::memory_order_acquire)) { return; }
+    }
+    if (ptr) { traits_type::decrement(ptr); }
+  }
+
+  /* Installs `next` if the current pointer satisfies `matches`. In both cases
+   * ptr receives the observed pointer and the caller owns one reference to
+   * it: the slot's own reference on success or a freshly retained one on
+   * failure.
+   */
+  template <class Predicate>
+  bool replace (word_type next, pointer& ptr, Predicate matches) const {
+    while (true) {
+      auto current = this->word.fetch_add(
+        count_unit,
+        std::memory_order_acquire) + count_unit;
+      ptr = unpack(current);
+      if (not matches(ptr)) {
+        if (ptr) { traits_type::increment(ptr); }
+        this->release(ptr, current);
+        return false;
+      }
+      word_type converted = 0;
+      while (unpack(current) == ptr) {
+        auto const outstanding = credits(current);
+        if (ptr and outstanding > converted) {
+          impl::increment_n<traits_type>(ptr, outstanding - converted);
+          converted = outstanding;
+        }
+        if (this->word.compare_exchange_weak(
+          current,
+          next,
+          std::memory_order_acq_rel,
+          std::memory_order_acquire)) {
+          if (ptr) {
+            impl::decrement_n<traits_type>(ptr, converted - outstanding + 1);
+          }
+          return true;
+        }
+      }
+      if (ptr) { impl::decrement_n<traits_type>(ptr, converted); }
+      this->release(ptr, current);
+    }
+  }
+
+  mutable std::atomic<word_type> word { 0 };
+};
+
+namespace impl {
+
+/* Thread local buffer of pending decrements. Consecutive releases of the same
+ * object are coalesced into one entry through a small direct mapped index,
+ * and the buffer is flushed when it fills up, on request, or on thread exit.
+ */
+struct release_buffer final {
+  using release_type = void (*)(void*, std::size_t);
+
+  static constexpr std::size_t capacity = 256;
+  static constexpr std::size_t buckets = 512;
+
+  static release_buffer& local () noexcept {
+    thread_local release_buffer buffer;
+    return buffer;
+  }
+
+  release_buffer () noexcept = default;
+  release_buffer (release_buffer const&) = delete;
+  release_buffer& operator = (release_buffer const&) = delete;
+  ~release_buffer () { this->flush(); }
+
+  void push (void* object, release_type release) {
+    auto& slot = this->index[bucket(object)];
+    if (not this->flushing and slot < this->size) {
+      auto& entry = this->entries[slot];
+      if (entry.object == object and entry.release == release) {
+        ++entry.count;
+        return;
+      }
+    }
+    if (this->size == capacity) {
+      if (this->flushing) { return release(object, 1); }
+      this->flush();
+    }
+    slot = static_cast<std::uint16_t>(this->size);
+    this->entries[this->size++] = entry_type { object, release, 1 };
+  }
+
+  /* Releases may destroy objects that drop further deferred references.
+   * Those are appended behind the entries being flushed, without
+   * coalescing, and are released in the same pass.
+   */
+  void flush () {
+    if (this->flushing) { return; }
+    this->flushing = true;
+    for (std::size_t idx = 0; idx < this->size; ++idx) {
+      auto entry = this->entries[idx];
+      entry.release(entry.object, entry.count);
+    }
+    this->size = 0;
+    this->flushing = false;
+  }
+
+  std::size_t pending () const noexcept { return this->size; }
+
+private:
+  struct entry_type {
+    void* object;
+    release_type release;
+    std::size_t count;
+  };
+
+  static std::size_t bucket (void* object) noexcept {
+    return (reinterpret_cast<std::uintptr_t>(object) >> 4) % buckets;
+  }
+
+  entry_type entries[capacity];
+  std::uint16_t index[buckets] { };
+  std::size_t size { 0 };
+  bool flushing { false };
+};
+
+} /* namespace impl */
+
+/* Traits adaptor that defers every decrement of R into a per-thread release
+ * buffer, so dropping a retain_ptr never runs a destructor inline. Objects
+ * are released at the latest when flush_deferred_releases() is called or the
+ * thread exits.
+ */
+template <class T, class R=retain_traits<T>>
+struct deferred_retain_traits {
+  using pointer = detected_or_t<add_pointer_t<T>, impl::has_pointer, R>;
+  using default_action = detected_or_t<
+    adopt_object_t,
+    impl::has_default_action,
+    R
+  >;
+
+  static_assert(
+    std::is_pointer_v<pointer>,
+    "deferred_retain_traits requires R::pointer to be a raw pointer");
+
+  static void increment (pointer ptr) { R::increment(ptr); }
+  static void increment (pointer ptr, std::size_t n) { impl::increment_n<R>(ptr, n); }
+
+  static void decrement (pointer ptr) {
+    impl::release_buffer::local().push(
+      const_cast<void*>(static_cast<void const volatile*>(ptr)),
+      &release);
+  }
+
+  template <class P = pointer>
+  static auto use_count (P ptr) -> decltype(R::use_count(ptr)) {
+    return R::use_count(ptr);
+  }
+
+private:
+  static void release (void* object, std::size_t count) {
+    impl::decrement_n<R>(static_cast<pointer>(object), count);
+  }
+};
+
+inline void flush_deferred_releases () {
+  impl::release_buffer::local().flush();
+}
+
 } /* namespace sg14 */
 
+namespace std {
+
+template <class T>
+struct hash<sg14::allocated_pointer<T>> {
+  size_t operator () (sg14::allocated_pointer<T> ptr) const noexcept {
+    return hash<T*> { }(ptr.get());
+  }
+};
+
+/* Hashes the object's identity, matching operator ==. */
+template <class T, class R>
+struct hash<sg14::retain_ptr<T, R>> {
+  size_t operator () (sg14::retain_ptr<T, R> const& ptr) const noexcept {
+    return hash<typename sg14::retain_ptr<T, R>::pointer> { }(ptr.get());
+  }
+};
+
+} /* namespace std */
+
 #endif /* SG14_MEMORY_HPP */
@@ -0,0 +1,305 @@
+#ifndef SG14_RCU_HPP
+#define SG14_RCU_HPP
+
+#include <sg14/memory.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sg14 {
+namespace impl {
+
+/* A reader's announcement in one domain. The domain and the thread using the
+ * record each hold an owner count, so whichever of the two goes away last
+ * frees it; a record with a single owner left is free for another thread.
+ */
+struct rcu_record final {
+  std::atomic<std::uint64_t> epoch { 0 };
+  std::atomic<unsigned> owners { 2 };
+  std::size_t nesting { 0 };
+  rcu_record* next { nullptr };
+};
+
+inline void release_rcu_record (rcu_record* record) noexcept {
+  if (record->owners.fetch_sub(1, std::memory_order_acq_rel) == 1) { delete record; }
+}
+
+struct rcu_thread_state final {
+  struct entry {
+    std::uint64_t domain;
+    rcu_record* record;
+  };
+
+  static rcu_thread_state& local () {
+    thread_local rcu_thread_state state;
+    return state;
+  }
+
+  ~rcu_thread_state () {
+    for (auto& item : this->entries) { release_rcu_record(item.record); }
+  }
+
+  rcu_record* find (std::uint64_t domain) const noexcept {
+    for (auto& item : this->entries) {
+      if (item.domain == domain) { return item.record; }
+    }
+    return nullptr;
+  }
+
+  /* Drops records whose domain has been destroyed. */
+  void prune () noexcept {
+    auto stale = [] (entry const& item) {
+      if (item.record->owners.load(std::memory_order_acquire) != 1) { return false; }
+      release_rcu_record(item.record);
+      return true;
+    };
+    this->entries.erase(
+      std::remove_if(this->entries.begin(), this->entries.end(), stale),
+      this->entries.end());
+  }
+
+  std::vector<entry> entries;
+};
+
+} /* namespace impl */
+
+/* Epoch based reclamation domain. Readers announce the epoch they entered
+ * in and read shared objects without any reference count traffic; objects
+ * retired into the domain are tagged with the epoch at retirement and are
+ * only passed to traits_type::decrement once every reader that could have
+ * seen them has left its critical section.
+ *
+ * A domain must not be destroyed while any thread is inside one of its read
+ * sections, and objects still pending at that point are released at once.
+ */
+struct rcu_domain final {
+  using dispose_type = void (*)(void*);
+
+  static rcu_domain& global () {
+    static rcu_domain domain;
+    return domain;
+  }
+
+  rcu_domain () noexcept : id { next_id() } { }
+
+  rcu_domain (rcu_domain const&) = delete;
+  rcu_domain& operator = (rcu_domain const&) = delete;
+
+  ~rcu_domain () {
+    for (auto& item : this->retired) { item.dispose(item.object); }
+    auto record = this->head.load(std::memory_order_acquire);
+    while (record) {
+      auto next = record->next;
+      impl::release_rcu_record(record);
+      record = next;
+    }
+  }
+
+  /* Hands the reference held by ptr to the domain. It must already be
+   * unreachable for new readers, e.g. swapped out of a shared slot.
+   */
+  template <class T, class R>
+  void retire (retain_ptr<T, R> ptr) {
+    static_assert(
+      std::is_pointer_v<typename retain_ptr<T, R>::pointer>,
+      "rcu_domain requires traits_type::pointer to be a raw pointer");
+    if (not ptr) { return; }
+    auto object = const_cast<void*>(static_cast<void const volatile*>(ptr.detach()));
+    this->retire(object, [] (void* object) {
+      R::decrement(static_cast<typename retain_ptr<T, R>::pointer>(object));
+    });
+  }
+
+  void retire (void* object, dispose_type dispose) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto const epoch = this->epoch.load(std::memory_order_seq_cst);
+    bool full;
+    {
+      std::lock_guard<std::mutex> lock { this->mutex };
+      this->retired.push_back(retired_object { object, dispose, epoch });
+      full = this->retired.size() >= this->threshold;
+    }
+    if (full) { this->reclaim(); }
+  }
+
+  /* Releases every retired object that no current reader can still see,
+   * without waiting for readers.
+   */
+  void reclaim () {
+    auto const current = this->epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto oldest = current;
+    for (auto record = this->head.load(std::memory_order_acquire); record; record = record->next) {
+      auto const epoch = record->epoch.load(std::memory_order_acquire);
+      if (epoch and epoch < oldest) { oldest = epoch; }
+    }
+    std::vector<retired_object> ready;
+    {
+      std::lock_guard<std::mutex> lock { this->mutex };
+      auto pending = std::stable_partition(
+        this->retired.begin(),
+        this->retired.end(),
+        [oldest] (retired_object const& item) { return item.epoch >= oldest; });
+      ready.assign(pending, this->retired.end());
+      this->retired.erase(pending, this->retired.end());
+      this->threshold = std::max<std::size_t>(64, 2 * this->retired.size());
+    }
+    for (auto& item : ready) { item.dispose(item.object); }
+  }
+
+  /* Waits for every read section in progress to end, then releases all
+   * objects retired before the call. Must not be called from inside a read
+   * section of this domain.
+   */
+  void synchronize () {
+    assert(not this->nested());
+    auto const target = this->epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (auto record = this->head.load(std::memory_order_acquire); record; record = record->next) {
+      while (true) {
+        auto const epoch = record->epoch.load(std::memory_order_acquire);
+        if (not epoch or epoch >= target) { break; }
+        std::this_thread::yield();
+      }
+    }
+    this->reclaim();
+  }
+
+private:
+  friend struct rcu_read_guard;
+
+  struct retired_object {
+    void* object;
+    dispose_type dispose;
+    std::uint64_t epoch;
+  };
+
+  static std::uint64_t next_id () noexcept {
+    static std::atomic<std::uint64_t> counter { 0 };
+    return counter.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool nested () const noexcept {
+    auto record = impl::rcu_thread_state::local().find(this->id);
+    return record and record->nesting;
+  }
+
+  impl::rcu_record* record () {
+    auto& state = impl::rcu_thread_state::local();
+    if (auto record = state.find(this->id)) { return record; }
+    state.prune();
+    state.entries.reserve(state.entries.size() + 1);
+    auto record = this->acquire();
+    state.entries.push_back({ this->id, record });
+    return record;
+  }
+
+  impl::rcu_record* acquire () {
+    for (auto record = this->head.load(std::memory_order_acquire); record; record = record->next) {
+      unsigned expected = 1;
+      if (record->owners.compare_exchange_strong(
+        expected,
+        2,
+        std::memory_order_acquire,
+        std::memory_order_relaxed)) { return record; }
+    }
+    auto record = new impl::rcu_record;
+    record->next = this->head.load(std::memory_order_relaxed);
+    while (not this->head.compare_exchange_weak(
+      record->next,
+      record,
+      std::memory_order_release,
+      std::memory_order_relaxed)) { }
+    return record;
+  }
+
+  std::atomic<std::uint64_t> epoch { 1 };
+  std::atomic<impl::rcu_record*> head { nullptr };
+  std::uint64_t const id;
+  std::mutex mutex;
+  std::vector<retired_object> retired;
+  std::size_t threshold { 64 };
+};
+
+/* Read side critical section of an rcu_domain. Sections nest, and only the
+ * outermost one announces itself to the domain.
+ */
+struct rcu_read_guard final {
+  explicit rcu_read_guard (rcu_domain& domain = rcu_domain::global()) :
+    record { domain.record() }
+  {
+    if (this->record->nesting++) { return; }
+    auto const epoch = domain.epoch.load(std::memory_order_seq_cst);
+    this->record->epoch.store(epoch, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  rcu_read_guard (rcu_read_guard const&) = delete;
+  rcu_read_guard& operator = (rcu_read_guard const&) = delete;
+
+  ~rcu_read_guard () {
+    if (--this->record->nesting) { return; }
+    this->record->epoch.store(0, std::memory_order_release);
+  }
+
+private:
+  impl::rcu_record* record;
+};
+
+/* Shared slot read under rcu_read_guard. Readers get the raw pointer, valid
+ * until their guard ends; writers retire the slot's previous reference into
+ * the domain.
+ */
+template <class T, class R=retain_traits<T>>
+struct rcu_retain_ptr {
+  using value_type = retain_ptr<T, R>;
+  using traits_type = R;
+  using pointer = typename value_type::pointer;
+
+  explicit rcu_retain_ptr (rcu_domain& domain = rcu_domain::global()) noexcept :
+    domain { domain }
+  { }
+
+  rcu_retain_ptr (value_type desired, rcu_domain& domain = rcu_domain::global()) noexcept :
+    domain { domain },
+    ptr { desired.detach() }
+  { }
+
+  rcu_retain_ptr (rcu_retain_ptr const&) = delete;
+  rcu_retain_ptr& operator = (rcu_retain_ptr const&) = delete;
+
+  ~rcu_retain_ptr () {
+    this->domain.retire(value_type(this->ptr.load(std::memory_order_acquire), adopt_object));
+  }
+
+  pointer get (rcu_read_guard const&) const noexcept {
+    return this->ptr.load(std::memory_order_acquire);
+  }
+
+  value_type load () const {
+    rcu_read_guard guard { this->domain };
+    return value_type(this->get(guard), retain_object);
+  }
+
+  void store (value_type desired) {
+    auto replaced = this->ptr.exchange(desired.detach(), std::memory_order_seq_cst);
+    this->domain.retire(value_type(replaced, adopt_object));
+  }
+
+  value_type exchange (value_type desired) {
+    auto replaced = this->ptr.exchange(desired.detach(), std::memory_order_seq_cst);
+    value_type previous { replaced, retain_object };
+    this->domain.retire(value_type(replaced, adopt_object));
+    return previous;
+  }
+
+private:
+  rcu_domain& domain;
+  std::atomic<pointer> ptr { nullptr };
+};
+
+} /* namespace sg14 */
+
+#endif /* SG14_RCU_HPP */
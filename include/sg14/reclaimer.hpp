@@ -0,0 +1,180 @@
+#ifndef SG14_RECLAIMER_HPP
+#define SG14_RECLAIMER_HPP
+
+#include <sg14/memory.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace sg14 {
+
+/* Link a reclaimer threads retired objects through, so retiring an object
+ * allocates nothing. Objects given to reclaiming_retain_traits derive from
+ * it next to their reference count mixin. Both members belong to whichever
+ * reclaimer the object was retired to.
+ */
+struct reclaim_hook {
+  using dispose_type = void (*)(reclaim_hook*);
+
+  reclaim_hook* next { nullptr };
+  dispose_type dispose { nullptr };
+
+protected:
+  reclaim_hook () noexcept = default;
+  reclaim_hook (reclaim_hook const&) noexcept { }
+  reclaim_hook& operator = (reclaim_hook const&) noexcept { return *this; }
+};
+
+/* Destroys retired objects on a dedicated thread. Producers push onto a
+ * lock-free intrusive stack; the reclaimer thread takes the whole stack at
+ * once and disposes of it in retirement order, sleeping on a condition
+ * variable only when there is nothing left to do.
+ *
+ * The shared instance() is never destroyed, so objects released by other
+ * static destructors still have somewhere to go; whatever is retired while
+ * the process exits is leaked instead of disposed of. shutdown() stops and
+ * joins its thread, after which retire disposes of objects inline. It must
+ * not race with retire.
+ */
+struct background_reclaimer final {
+  using dispose_type = reclaim_hook::dispose_type;
+
+  static background_reclaimer& instance () {
+    static auto reclaimer = new background_reclaimer;
+    return *reclaimer;
+  }
+
+  static void retire (reclaim_hook* object, dispose_type dispose) noexcept {
+    instance().push(object, dispose);
+  }
+
+  /* Blocks until every object retired before the call has been disposed of. */
+  static void drain () noexcept { instance().wait(); }
+
+  static void shutdown () { instance().stop(); }
+
+  background_reclaimer () : worker { [this] { this->run(); } } { }
+
+  background_reclaimer (background_reclaimer const&) = delete;
+  background_reclaimer& operator = (background_reclaimer const&) = delete;
+
+  ~background_reclaimer () { this->stop(); }
+
+  void push (reclaim_hook* object, dispose_type dispose) noexcept {
+    if (this->stopping.load(std::memory_order_acquire)) { return dispose(object); }
+    object->dispose = dispose;
+    object->next = this->head.load(std::memory_order_relaxed);
+    while (not this->head.compare_exchange_weak(
+      object->next,
+      object,
+      std::memory_order_seq_cst,
+      std::memory_order_relaxed)) { }
+    this->retired.fetch_add(1, std::memory_order_release);
+    if (this->sleeping.load(std::memory_order_seq_cst)) {
+      std::lock_guard<std::mutex> lock { this->mutex };
+      this->wakeup.notify_one();
+    }
+  }
+
+  void wait () const noexcept {
+    auto const target = this->retired.load(std::memory_order_acquire);
+    while (this->reclaimed.load(std::memory_order_acquire) < target) {
+      std::this_thread::yield();
+    }
+  }
+
+  /* Disposes of everything already retired and joins the thread. */
+  void stop () {
+    {
+      std::lock_guard<std::mutex> lock { this->mutex };
+      if (this->stopping.exchange(true, std::memory_order_acq_rel)) { return; }
+    }
+    this->wakeup.notify_one();
+    this->worker.join();
+  }
+
+private:
+  void run () {
+    while (true) {
+      auto list = this->head.exchange(nullptr, std::memory_order_acquire);
+      if (not list) {
+        std::unique_lock<std::mutex> lock { this->mutex };
+        this->sleeping.store(true, std::memory_order_seq_cst);
+        this->wakeup.wait(lock, [this] {
+          return this->stopping.load(std::memory_order_relaxed)
+            or this->head.load(std::memory_order_seq_cst);
+        });
+        this->sleeping.store(false, std::memory_order_relaxed);
+        if (this->stopping.load(std::memory_order_relaxed) and not this->head.load()) { return; }
+        continue;
+      }
+      reclaim_hook* ordered = nullptr;
+      while (list) {
+        auto next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+      }
+      while (ordered) {
+        auto next = ordered->next;
+        ordered->dispose(ordered);
+        ordered = next;
+        this->reclaimed.fetch_add(1, std::memory_order_release);
+      }
+    }
+  }
+
+  std::atomic<reclaim_hook*> head { nullptr };
+  std::atomic<bool> sleeping { false };
+  std::atomic<bool> stopping { false };
+  std::atomic<std::size_t> retired { 0 };
+  std::atomic<std::size_t> reclaimed { 0 };
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::thread worker;
+};
+
+/* Disposes of retired objects on the calling thread. */
+struct inline_reclaimer final {
+  static void retire (reclaim_hook* object, reclaim_hook::dispose_type dispose) {
+    dispose(object);
+  }
+};
+
+/* Traits that hand the last reference to an object to Reclaimer instead of
+ * deleting it inline. T derives from reclaim_hook. R must provide
+ * release(ptr), which drops a reference and reports whether it was the last
+ * one, as retain_traits does.
+ */
+template <
+  class T,
+  class Reclaimer=background_reclaimer,
+  class R=retain_traits<T>
+> struct reclaiming_retain_traits {
+  using pointer = T*;
+
+  static void increment (pointer ptr) noexcept { R::increment(ptr); }
+  static void increment (pointer ptr, std::size_t n) noexcept { impl::increment_n<R>(ptr, n); }
+
+  static void decrement (pointer ptr) {
+    static_assert(
+      std::is_base_of_v<reclaim_hook, T>,
+      "reclaiming_retain_traits requires T to derive from reclaim_hook");
+    if (R::release(ptr)) { Reclaimer::retire(static_cast<reclaim_hook*>(ptr), &dispose); }
+  }
+
+  template <class P = pointer>
+  static auto use_count (P ptr) -> decltype(R::use_count(ptr)) {
+    return R::use_count(ptr);
+  }
+
+private:
+  static void dispose (reclaim_hook* object) {
+    delete static_cast<pointer>(object);
+  }
+};
+
+} /* namespace sg14 */
+
+#endif /* SG14_RECLAIMER_HPP */
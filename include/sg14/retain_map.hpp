@@ -0,0 +1,326 @@
+#ifndef SG14_RETAIN_MAP_HPP
+#define SG14_RETAIN_MAP_HPP
+
+#include <sg14/retain_vector.hpp>
+
+#include <iterator>
+
+namespace sg14 {
+
+/* Open addressing map keyed by object identity. Each entry owns a reference
+ * to its key; lookups take the raw pointer, so finding an object never
+ * touches its reference count. Keys live in one contiguous array probed
+ * linearly, with null marking an empty slot, and values in a parallel array.
+ * Erasing shifts the following entries back instead of leaving tombstones.
+ *
+ * Inserting or erasing invalidates iterators and references into the map.
+ */
+template <class T, class V, class R=retain_traits<T>>
+struct retain_map {
+  using key_type = retain_ptr<T, R>;
+  using mapped_type = V;
+  using pointer = typename key_type::pointer;
+  using size_type = std::size_t;
+
+  static_assert(
+    std::is_pointer_v<pointer>,
+    "retain_map requires traits_type::pointer to be a raw pointer");
+  static_assert(
+    is_trivially_relocatable_v<V> or std::is_nothrow_move_constructible_v<V>,
+    "retain_map requires a relocatable or nothrow movable mapped_type");
+
+  template <bool Const>
+  struct basic_iterator {
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<key_type const&, conditional_t<Const, V const&, V&>>;
+    using reference = value_type;
+
+    basic_iterator () noexcept = default;
+    template <bool C, class=std::enable_if_t<Const and not C>>
+    basic_iterator (basic_iterator<C> const& that) noexcept :
+      map { that.map },
+      idx { that.idx }
+    { }
+
+    reference operator * () const noexcept {
+      return reference { this->map->keys[this->idx], this->map->values[this->idx] };
+    }
+
+    basic_iterator& operator ++ () noexcept {
+      this->idx = this->map->occupied(this->idx + 1);
+      return *this;
+    }
+
+    basic_iterator operator ++ (int) noexcept {
+      auto previous = *this;
+      ++*this;
+      return previous;
+    }
+
+    bool operator == (basic_iterator const& that) const noexcept { return this->idx == that.idx; }
+    bool operator != (basic_iterator const& that) const noexcept { return this->idx != that.idx; }
+
+  private:
+    friend struct retain_map;
+    using map_type = conditional_t<Const, retain_map const, retain_map>;
+
+    basic_iterator (map_type* map, size_type idx) noexcept : map { map }, idx { idx } { }
+
+    map_type* map { nullptr };
+    size_type idx { 0 };
+  };
+
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  retain_map (retain_map const& that) : retain_map { } {
+    this->reserve(that.size());
+    for (auto entry : that) { this->try_emplace(entry.first, entry.second); }
+  }
+
+  retain_map (retain_map&& that) noexcept :
+    keys { std::exchange(that.keys, nullptr) },
+    values { std::exchange(that.values, nullptr) },
+    count { std::exchange(that.count, 0) },
+    slots { std::exchange(that.slots, 0) },
+    shift { std::exchange(that.shift, digits) }
+  { }
+
+  retain_map () noexcept = default;
+  ~retain_map () {
+    this->clear();
+    deallocate(this->keys, this->values, this->capacity());
+  }
+
+  retain_map& operator = (retain_map const& that) {
+    retain_map(that).swap(*this);
+    return *this;
+  }
+
+  retain_map& operator = (retain_map&& that) noexcept {
+    retain_map(std::move(that)).swap(*this);
+    return *this;
+  }
+
+  void swap (retain_map& that) noexcept {
+    using std::swap;
+    swap(this->keys, that.keys);
+    swap(this->values, that.values);
+    swap(this->count, that.count);
+    swap(this->slots, that.slots);
+    swap(this->shift, that.shift);
+  }
+
+  iterator begin () noexcept { return iterator(this, this->occupied(0)); }
+  iterator end () noexcept { return iterator(this, this->capacity()); }
+  const_iterator begin () const noexcept { return const_iterator(this, this->occupied(0)); }
+  const_iterator end () const noexcept { return const_iterator(this, this->capacity()); }
+
+  size_type size () const noexcept { return this->count; }
+  bool empty () const noexcept { return not this->count; }
+  size_type capacity () const noexcept { return this->slots; }
+
+  V* find (pointer key) noexcept {
+    auto idx = this->locate(key);
+    return idx == npos ? nullptr : this->values + idx;
+  }
+
+  V const* find (pointer key) const noexcept {
+    auto idx = this->locate(key);
+    return idx == npos ? nullptr : this->values + idx;
+  }
+
+  V* find (key_type const& key) noexcept { return this->find(key.get()); }
+  V const* find (key_type const& key) const noexcept { return this->find(key.get()); }
+
+  bool contains (pointer key) const noexcept { return this->locate(key) != npos; }
+  bool contains (key_type const& key) const noexcept { return this->contains(key.get()); }
+
+  /* Retains key only if it is inserted. */
+  template <class... Args>
+  std::pair<V*, bool> try_emplace (key_type const& key, Args&&... args) {
+    return this->emplace(key.get(), retain_object, std::forward<Args>(args)...);
+  }
+
+  /* Takes over the reference held by key only if it is inserted. */
+  template <class... Args>
+  std::pair<V*, bool> try_emplace (key_type&& key, Args&&... args) {
+    auto result = this->emplace(key.get(), adopt_object, std::forward<Args>(args)...);
+    if (result.second) { key.detach(); }
+    return result;
+  }
+
+  template <class K>
+  std::pair<V*, bool> insert_or_assign (K&& key, V value) {
+    auto result = this->try_emplace(std::forward<K>(key), std::move(value));
+    if (not result.second) { *result.first = std::move(value); }
+    return result;
+  }
+
+  V& operator [] (key_type const& key) { return *this->try_emplace(key).first; }
+
+  size_type erase (pointer key) noexcept {
+    auto idx = this->locate(key);
+    if (idx == npos) { return 0; }
+    this->remove(idx);
+    return 1;
+  }
+
+  size_type erase (key_type const& key) noexcept { return this->erase(key.get()); }
+
+  void clear () noexcept {
+    for (size_type idx = 0; idx < this->capacity() and this->count; ++idx) {
+      if (not this->keys[idx]) { continue; }
+      this->values[idx].~V();
+      this->keys[idx].reset();
+      --this->count;
+    }
+  }
+
+  void reserve (size_type n) {
+    size_type target = minimum;
+    while (target - target / 4 < n) { target *= 2; }
+    if (target > this->capacity()) { this->rehash(target); }
+  }
+
+private:
+  static constexpr size_type npos = size_type(-1);
+  static constexpr size_type minimum = 16;
+  static constexpr unsigned digits = 64;
+
+  /* Fibonacci hashing: object addresses share their low bits, so the slot
+   * comes from the high bits of the product. Folding the upper half in
+   * first breaks up the regular strides of interleaved allocations.
+   */
+  size_type slot (pointer key) const noexcept {
+    auto bits = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key));
+    bits ^= bits >> 32;
+    return static_cast<size_type>((bits * 0x9E3779B97F4A7C15ull) >> this->shift);
+  }
+
+  size_type mask () const noexcept { return this->capacity() - 1; }
+
+  size_type occupied (size_type idx) const noexcept {
+    while (idx < this->capacity() and not this->keys[idx]) { ++idx; }
+    return idx;
+  }
+
+  size_type locate (pointer key) const noexcept {
+    if (not this->count or not key) { return npos; }
+    for (auto idx = this->slot(key); ; idx = (idx + 1) & this->mask()) {
+      auto current = this->keys[idx].get();
+      if (current == key) { return idx; }
+      if (not current) { return npos; }
+    }
+  }
+
+  size_type vacant (pointer key) const noexcept {
+    auto idx = this->slot(key);
+    while (this->keys[idx]) { idx = (idx + 1) & this->mask(); }
+    return idx;
+  }
+
+  /* The arguments may refer to values in this map, so when it has to grow
+   * the new value is constructed before the old storage is released.
+   */
+  template <class Action, class... Args>
+  std::pair<V*, bool> emplace (pointer key, Action action, Args&&... args) {
+    assert(key);
+    if (auto idx = this->locate(key); idx != npos) { return { this->values + idx, false }; }
+    V* value = nullptr;
+    auto insert = [&] {
+      auto idx = this->vacant(key);
+      ::new (static_cast<void*>(this->values + idx)) V(std::forward<Args>(args)...);
+      this->keys[idx].reset(key, action);
+      ++this->count;
+      value = this->values + idx;
+    };
+    if (this->count + 1 > this->capacity() - this->capacity() / 4) {
+      this->rehash(this->capacity() ? 2 * this->capacity() : minimum, insert);
+    } else { insert(); }
+    return { value, true };
+  }
+
+  /* Backward shift deletion: entries after the hole move into it unless
+   * that would put them before their home slot.
+   */
+  void remove (size_type idx) noexcept {
+    this->values[idx].~V();
+    this->keys[idx].reset();
+    --this->count;
+    auto hole = idx;
+    for (auto next = (hole + 1) & this->mask(); this->keys[next]; next = (next + 1) & this->mask()) {
+      auto home = this->slot(this->keys[next].get());
+      if (((next - home) & this->mask()) < ((next - hole) & this->mask())) { continue; }
+      this->keys[hole].swap(this->keys[next]);
+      relocate_at(this->values + next, this->values + hole);
+      hole = next;
+    }
+  }
+
+  void rehash (size_type n) { this->rehash(n, [] { }); }
+
+  /* Moves every entry into arrays of n slots. place runs against the new
+   * arrays while the old ones are still alive; if it throws, the map is
+   * left as it was.
+   */
+  template <class Place>
+  void rehash (size_type n, Place place) {
+    auto keys = std::allocator<key_type> { }.allocate(n);
+    V* values;
+    try { values = std::allocator<V> { }.allocate(n); }
+    catch (...) {
+      std::allocator<key_type> { }.deallocate(keys, n);
+      throw;
+    }
+    for (size_type idx = 0; idx < n; ++idx) { ::new (static_cast<void*>(keys + idx)) key_type { }; }
+
+    auto old_capacity = this->capacity();
+    auto old_shift = this->shift;
+    auto old_keys = std::exchange(this->keys, keys);
+    auto old_values = std::exchange(this->values, values);
+    unsigned bits = 0;
+    while ((size_type { 1 } << bits) < n) { ++bits; }
+    this->shift = digits - bits;
+    this->slots = n;
+
+    try { place(); }
+    catch (...) {
+      deallocate(std::exchange(this->keys, old_keys), std::exchange(this->values, old_values), n);
+      this->shift = old_shift;
+      this->slots = old_capacity;
+      throw;
+    }
+
+    for (size_type idx = 0; idx < old_capacity; ++idx) {
+      if (not old_keys[idx]) { continue; }
+      auto target = this->vacant(old_keys[idx].get());
+      this->keys[target].swap(old_keys[idx]);
+      relocate_at(old_values + idx, this->values + target);
+    }
+    deallocate(old_keys, old_values, old_capacity);
+  }
+
+  static void deallocate (key_type* keys, V* values, size_type n) noexcept {
+    if (not keys) { return; }
+    for (size_type idx = 0; idx < n; ++idx) { keys[idx].~key_type(); }
+    std::allocator<key_type> { }.deallocate(keys, n);
+    std::allocator<V> { }.deallocate(values, n);
+  }
+
+  key_type* keys { nullptr };
+  V* values { nullptr };
+  size_type count { 0 };
+  size_type slots { 0 };
+  unsigned shift { digits };
+};
+
+template <class T, class V, class R>
+void swap (retain_map<T, V, R>& lhs, retain_map<T, V, R>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+} /* namespace sg14 */
+
+#endif /* SG14_RETAIN_MAP_HPP */
@@ -0,0 +1,218 @@
+#ifndef SG14_RETAIN_VECTOR_HPP
+#define SG14_RETAIN_VECTOR_HPP
+
+#include <sg14/memory.hpp>
+
+#include <cstring>
+#include <initializer_list>
+
+namespace sg14 {
+
+/* Moves the T at source into the uninitialized storage at dest and ends the
+ * lifetime of the source, as one operation.
+ */
+template <class T>
+T* relocate_at (T* source, T* dest) noexcept(
+  is_trivially_relocatable_v<T> or std::is_nothrow_move_constructible_v<T>
+) {
+  if constexpr (is_trivially_relocatable_v<T>) {
+    std::memmove(static_cast<void*>(dest), static_cast<void const*>(source), sizeof(T));
+    return std::launder(dest);
+  } else {
+    auto result = ::new (static_cast<void*>(dest)) T(std::move(*source));
+    source->~T();
+    return result;
+  }
+}
+
+/* Relocates [first, last) into the uninitialized storage starting at dest,
+ * which may overlap the source as long as dest is not after first. Trivially
+ * relocatable types are moved with a single memmove.
+ */
+template <class T>
+T* uninitialized_relocate (T* first, T* last, T* dest) noexcept(
+  is_trivially_relocatable_v<T> or std::is_nothrow_move_constructible_v<T>
+) {
+  if constexpr (is_trivially_relocatable_v<T>) {
+    auto count = static_cast<std::size_t>(last - first);
+    if (count) {
+      std::memmove(
+        static_cast<void*>(dest),
+        static_cast<void const*>(first),
+        count * sizeof(T));
+    }
+    return dest + count;
+  } else {
+    for (; first != last; ++first, ++dest) { relocate_at(first, dest); }
+    return dest;
+  }
+}
+
+/* A vector that grows and erases by relocating its elements, so a vector
+ * of retain_ptr reallocates with one memcpy instead of a move and a
+ * destructor per element. Elements must be trivially relocatable or nothrow
+ * move constructible; every operation that relocates is then noexcept apart
+ * from allocation.
+ */
+template <class T>
+struct relocating_vector {
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = T const&;
+  using pointer = T*;
+  using const_pointer = T const*;
+  using iterator = T*;
+  using const_iterator = T const*;
+
+  static_assert(
+    is_trivially_relocatable_v<T> or std::is_nothrow_move_constructible_v<T>,
+    "relocating_vector requires a relocatable or nothrow movable T");
+
+  relocating_vector (std::initializer_list<T> items) : relocating_vector { } {
+    this->reserve(items.size());
+    for (auto& item : items) { this->emplace_back(item); }
+  }
+
+  relocating_vector (relocating_vector const& that) : relocating_vector { } {
+    this->reserve(that.size());
+    for (auto& item : that) { this->emplace_back(item); }
+  }
+
+  relocating_vector (relocating_vector&& that) noexcept :
+    first { std::exchange(that.first, nullptr) },
+    last { std::exchange(that.last, nullptr) },
+    limit { std::exchange(that.limit, nullptr) }
+  { }
+
+  relocating_vector () noexcept = default;
+  ~relocating_vector () {
+    this->clear();
+    deallocate(this->first, this->capacity());
+  }
+
+  relocating_vector& operator = (relocating_vector const& that) {
+    relocating_vector(that).swap(*this);
+    return *this;
+  }
+
+  relocating_vector& operator = (relocating_vector&& that) noexcept {
+    relocating_vector(std::move(that)).swap(*this);
+    return *this;
+  }
+
+  void swap (relocating_vector& that) noexcept {
+    using std::swap;
+    swap(this->first, that.first);
+    swap(this->last, that.last);
+    swap(this->limit, that.limit);
+  }
+
+  iterator begin () noexcept { return this->first; }
+  iterator end () noexcept { return this->last; }
+  const_iterator begin () const noexcept { return this->first; }
+  const_iterator end () const noexcept { return this->last; }
+
+  reference operator [] (size_type idx) noexcept { return this->first[idx]; }
+  const_reference operator [] (size_type idx) const noexcept { return this->first[idx]; }
+
+  reference front () noexcept { return *this->first; }
+  reference back () noexcept { return this->last[-1]; }
+  const_reference front () const noexcept { return *this->first; }
+  const_reference back () const noexcept { return this->last[-1]; }
+
+  pointer data () noexcept { return this->first; }
+  const_pointer data () const noexcept { return this->first; }
+
+  size_type size () const noexcept { return static_cast<size_type>(this->last - this->first); }
+  size_type capacity () const noexcept { return static_cast<size_type>(this->limit - this->first); }
+  bool empty () const noexcept { return this->first == this->last; }
+
+  void reserve (size_type n) {
+    if (n <= this->capacity()) { return; }
+    auto storage = allocate(n);
+    this->adopt(storage, n, uninitialized_relocate(this->first, this->last, storage));
+  }
+
+  void shrink_to_fit () {
+    if (this->last == this->limit) { return; }
+    auto n = this->size();
+    auto storage = n ? allocate(n) : nullptr;
+    this->adopt(storage, n, uninitialized_relocate(this->first, this->last, storage));
+  }
+
+  /* The new element is constructed before the old ones are relocated, so
+   * args may refer to elements of this vector.
+   */
+  template <class... Args>
+  reference emplace_back (Args&&... args) {
+    if (this->last != this->limit) {
+      ::new (static_cast<void*>(this->last)) T(std::forward<Args>(args)...);
+      return *this->last++;
+    }
+    auto n = this->grown();
+    auto storage = allocate(n);
+    auto slot = storage + this->size();
+    try { ::new (static_cast<void*>(slot)) T(std::forward<Args>(args)...); }
+    catch (...) {
+      deallocate(storage, n);
+      throw;
+    }
+    uninitialized_relocate(this->first, this->last, storage);
+    this->adopt(storage, n, slot + 1);
+    return *slot;
+  }
+
+  void push_back (T const& value) { this->emplace_back(value); }
+  void push_back (T&& value) { this->emplace_back(std::move(value)); }
+
+  void pop_back () noexcept { (--this->last)->~T(); }
+
+  /* Destroys the element at position and relocates the tail down over it. */
+  iterator erase (const_iterator position) noexcept {
+    auto target = this->first + (position - this->first);
+    target->~T();
+    this->last = uninitialized_relocate(target + 1, this->last, target);
+    return target;
+  }
+
+  void clear () noexcept {
+    while (this->last != this->first) { (--this->last)->~T(); }
+  }
+
+private:
+  static T* allocate (size_type n) { return std::allocator<T> { }.allocate(n); }
+
+  static void deallocate (T* storage, size_type n) noexcept {
+    if (storage) { std::allocator<T> { }.deallocate(storage, n); }
+  }
+
+  size_type grown () const noexcept {
+    auto n = this->capacity();
+    return n ? 2 * n : 8;
+  }
+
+  void adopt (T* storage, size_type n, T* end) noexcept {
+    deallocate(this->first, this->capacity());
+    this->first = storage;
+    this->last = end;
+    this->limit = storage + n;
+  }
+
+  T* first { nullptr };
+  T* last { nullptr };
+  T* limit { nullptr };
+};
+
+template <class T>
+void swap (relocating_vector<T>& lhs, relocating_vector<T>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+template <class T, class R=retain_traits<T>>
+using retain_vector = relocating_vector<retain_ptr<T, R>>;
+
+} /* namespace sg14 */
+
+#endif /* SG14_RETAIN_VECTOR_HPP */
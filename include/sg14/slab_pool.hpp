@@ -0,0 +1,221 @@
+#ifndef SG14_SLAB_POOL_HPP
+#define SG14_SLAB_POOL_HPP
+
+#include <sg14/memory.hpp>
+
+#include <mutex>
+#include <new>
+
+namespace sg14 {
+namespace impl {
+
+/* Per-thread cache of the slab pool. Blocks freed by the owning thread go on
+ * a plain free list, blocks freed elsewhere on an atomic list that the owner
+ * takes over in one exchange once its own list runs dry. Caches are never
+ * destroyed: when a thread exits its cache is parked and adopted by the next
+ * thread, so blocks it carved out always have a live owner.
+ */
+struct slab_cache final {
+  static constexpr std::size_t granularity = 16;
+  static constexpr std::size_t classes = 16;
+  static constexpr std::size_t max_size = granularity * classes;
+  static constexpr std::size_t slab_size = std::size_t { 1 } << 16;
+
+  struct header {
+    slab_cache* owner;
+    std::size_t size_class;
+  };
+
+  static constexpr std::size_t header_size = 64;
+
+  static slab_cache* local () {
+    struct holder {
+      slab_cache* cache = adopt();
+      ~holder () { abandon(this->cache); }
+    };
+    thread_local holder instance;
+    return instance.cache;
+  }
+
+  static header* header_of (void* block) noexcept {
+    auto address = reinterpret_cast<std::uintptr_t>(block);
+    return reinterpret_cast<header*>(address & ~(slab_size - 1));
+  }
+
+  static std::size_t size_class (std::size_t size) noexcept {
+    return size ? (size - 1) / granularity : 0;
+  }
+
+  void* allocate (std::size_t index) {
+    auto& bin = this->bins[index];
+    if (not bin.local) {
+      bin.local = bin.remote.exchange(nullptr, std::memory_order_acquire);
+    }
+    if (bin.local) {
+      auto block = bin.local;
+      bin.local = *static_cast<void**>(block);
+      return block;
+    }
+    auto const size = (index + 1) * granularity;
+    if (bin.limit - bin.cursor < static_cast<std::ptrdiff_t>(size)) {
+      auto slab = static_cast<char*>(
+        ::operator new(slab_size, std::align_val_t { slab_size }));
+      ::new (slab) header { this, index };
+      bin.cursor = slab + header_size;
+      bin.limit = slab + slab_size;
+    }
+    auto block = bin.cursor;
+    bin.cursor += size;
+    return block;
+  }
+
+  void deallocate_local (void* block, std::size_t index) noexcept {
+    auto& bin = this->bins[index];
+    *static_cast<void**>(block) = bin.local;
+    bin.local = block;
+  }
+
+  void deallocate_remote (void* block, std::size_t index) noexcept {
+    auto& remote = this->bins[index].remote;
+    auto head = remote.load(std::memory_order_relaxed);
+    do { *static_cast<void**>(block) = head; }
+    while (not remote.compare_exchange_weak(
+      head,
+      block,
+      std::memory_order_release,
+      std::memory_order_relaxed));
+  }
+
+private:
+  struct bin {
+    void* local { nullptr };
+    std::atomic<void*> remote { nullptr };
+    char* cursor { nullptr };
+    char* limit { nullptr };
+  };
+
+  struct parking {
+    std::mutex mutex;
+    slab_cache* head { nullptr };
+  };
+
+  static parking& parked () {
+    static parking instance;
+    return instance;
+  }
+
+  static slab_cache* adopt () {
+    auto& lot = parked();
+    std::lock_guard<std::mutex> lock { lot.mutex };
+    if (not lot.head) { return new slab_cache; }
+    auto cache = lot.head;
+    lot.head = cache->next;
+    return cache;
+  }
+
+  static void abandon (slab_cache* cache) {
+    auto& lot = parked();
+    std::lock_guard<std::mutex> lock { lot.mutex };
+    cache->next = lot.head;
+    lot.head = cache;
+  }
+
+  bin bins[classes];
+  slab_cache* next { nullptr };
+};
+
+} /* namespace impl */
+
+/* Size-class slab allocator for small objects. Requests up to
+ * slab_pool::max_size bytes are served from 64KiB slabs through a per-thread
+ * cache, larger ones go to the global operator new. Blocks have the default
+ * new alignment only; over-aligned types must not be allocated here.
+ */
+struct slab_pool final {
+  static constexpr std::size_t max_size = impl::slab_cache::max_size;
+
+  static void* allocate (std::size_t size) {
+    if (size > max_size) { return ::operator new(size); }
+    return impl::slab_cache::local()->allocate(impl::slab_cache::size_class(size));
+  }
+
+  static void deallocate (void* block, std::size_t size) noexcept {
+    if (not block) { return; }
+    if (size > max_size) { return ::operator delete(block); }
+    auto header = impl::slab_cache::header_of(block);
+    if (header->owner == impl::slab_cache::local()) {
+      return header->owner->deallocate_local(block, header->size_class);
+    }
+    header->owner->deallocate_remote(block, header->size_class);
+  }
+};
+
+/* Base class routing new and delete of the derived type through the slab
+ * pool, so retain_traits::decrement releases into the pool without any
+ * other change. Over-aligned types keep using the global allocator.
+ */
+struct pooled {
+  static void* operator new (std::size_t size) {
+    return slab_pool::allocate(size);
+  }
+
+  static void operator delete (void* block, std::size_t size) noexcept {
+    slab_pool::deallocate(block, size);
+  }
+
+  static void* operator new (std::size_t size, std::align_val_t align) {
+    return ::operator new(size, align);
+  }
+
+  static void operator delete (
+    void* block,
+    std::size_t size,
+    std::align_val_t align
+  ) noexcept { ::operator delete(block, size, align); }
+};
+
+template <class T>
+struct slab_allocator {
+  using value_type = T;
+
+  slab_allocator () noexcept = default;
+  template <class U>
+  slab_allocator (slab_allocator<U> const&) noexcept { }
+
+  /* Like pooled, over-aligned types keep using the global allocator. */
+  T* allocate (std::size_t n) {
+    static_assert(
+      not impl::is_weak_counted<T>::value,
+      "weak counted objects must be created with new T or make_retained");
+    if constexpr (over_aligned) {
+      return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t { alignof(T) }));
+    } else {
+      return static_cast<T*>(slab_pool::allocate(n * sizeof(T)));
+    }
+  }
+
+  void deallocate (T* ptr, std::size_t n) noexcept {
+    if constexpr (over_aligned) {
+      ::operator delete(ptr, n * sizeof(T), std::align_val_t { alignof(T) });
+    } else {
+      slab_pool::deallocate(ptr, n * sizeof(T));
+    }
+  }
+
+private:
+  static constexpr bool over_aligned = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+};
+
+template <class T, class U>
+bool operator == (slab_allocator<T> const&, slab_allocator<U> const&) noexcept {
+  return true;
+}
+
+template <class T, class U>
+bool operator != (slab_allocator<T> const&, slab_allocator<U> const&) noexcept {
+  return false;
+}
+
+} /* namespace sg14 */
+
+#endif /* SG14_SLAB_POOL_HPP */
@@ -0,0 +1,96 @@
+#include "doctest.hpp"
+#include <sg14/memory.hpp>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct node : sg14::atomic_reference_count<node> {
+  static std::atomic<long> instances;
+
+  node (long value) : value { value } { ++instances; }
+  ~node () { --instances; }
+
+  long value;
+};
+
+std::atomic<long> node::instances { 0 };
+
+using node_ptr = sg14::retain_ptr<node>;
+
+} /* nameless namespace */
+
+TEST_CASE("atomic_retain_ptr load and store") {
+  {
+    sg14::atomic_retain_ptr<node> slot { node_ptr { new node { 1 } } };
+    auto first = slot.load();
+    REQUIRE(first->value == 1);
+    REQUIRE(first.use_count() == 2);
+
+    slot.store(node_ptr { new node { 2 } });
+    REQUIRE(first.use_count() == 1);
+    REQUIRE(node::instances == 2);
+
+    auto previous = slot.exchange(nullptr);
+    REQUIRE(previous->value == 2);
+    REQUIRE(previous.use_count() == 1);
+    REQUIRE(not slot.load());
+  }
+  REQUIRE(node::instances == 0);
+}
+
+TEST_CASE("atomic_retain_ptr compare_exchange") {
+  {
+    node_ptr one { new node { 1 } };
+    node_ptr two { new node { 2 } };
+    sg14::atomic_retain_ptr<node> slot { one };
+
+    auto expected = two;
+    REQUIRE(not slot.compare_exchange_strong(expected, two));
+    REQUIRE(expected == one);
+    REQUIRE(one.use_count() == 3);
+
+    REQUIRE(slot.compare_exchange_strong(expected, two));
+    REQUIRE(slot.load() == two);
+    REQUIRE(one.use_count() == 2);
+    REQUIRE(two.use_count() == 2);
+  }
+  REQUIRE(node::instances == 0);
+}
+
+TEST_CASE("atomic_retain_ptr concurrent readers and writers") {
+  constexpr int iterations = 20000;
+  {
+    sg14::atomic_retain_ptr<node> slot { node_ptr { new node { 0 } } };
+    std::atomic<bool> failed { false };
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < 4; ++idx) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < iterations; ++i) {
+          auto ptr = slot.load();
+          if (not ptr or ptr.use_count() < 1 or ptr->value < 0) {
+            failed = true;
+          }
+        }
+      });
+    }
+    for (int idx = 0; idx < 2; ++idx) {
+      threads.emplace_back([&, idx] {
+        for (int i = 0; i < iterations; ++i) {
+          if (idx) {
+            slot.store(node_ptr { new node { i } });
+            continue;
+          }
+          auto expected = slot.load();
+          slot.compare_exchange_strong(expected, node_ptr { new node { i } });
+        }
+      });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    REQUIRE(not failed);
+    REQUIRE(slot.load().use_count() == 2);
+    REQUIRE(node::instances == 1);
+  }
+  REQUIRE(node::instances == 0);
+}
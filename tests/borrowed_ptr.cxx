@@ -0,0 +1,86 @@
+#include "doctest.hpp"
+#include <sg14/memory.hpp>
+
+namespace {
+
+struct base : sg14::reference_count<base> {
+  static inline int destroyed = 0;
+  virtual ~base () { ++destroyed; }
+  int value { 3 };
+};
+
+struct derived final : base { };
+
+/* Counts every reference count operation on a base. */
+struct counting_traits {
+  static inline long operations = 0;
+  static void increment (base* ptr) noexcept {
+    ++operations;
+    sg14::retain_traits<base>::increment(ptr);
+  }
+  static void decrement (base* ptr) noexcept {
+    ++operations;
+    sg14::retain_traits<base>::decrement(ptr);
+  }
+  static long use_count (base* ptr) noexcept {
+    return sg14::retain_traits<base>::use_count(ptr);
+  }
+};
+
+using owner = sg14::retain_ptr<base, counting_traits>;
+using borrowed = sg14::borrowed_ptr<base, counting_traits>;
+
+int read (borrowed ptr, int depth) {
+  return depth ? read(ptr, depth - 1) : ptr->value;
+}
+
+} /* nameless namespace */
+
+TEST_CASE("borrowed_ptr passes through calls without count traffic") {
+  owner ptr { new base };
+  counting_traits::operations = 0;
+  CHECK(read(ptr, 8) == 3);
+  borrowed view = ptr;
+  auto copy = view;
+  CHECK(copy == view);
+  CHECK(copy.get() == ptr.get());
+  CHECK(copy.use_count() == 1);
+  CHECK(counting_traits::operations == 0);
+}
+
+TEST_CASE("borrowed_ptr retains only when asked") {
+  base::destroyed = 0;
+  borrowed view;
+  CHECK(not view);
+  CHECK(view == nullptr);
+  CHECK(view.use_count() == 0);
+  CHECK(not view.retain());
+
+  owner kept;
+  {
+    owner ptr { new base };
+    view = ptr;
+    counting_traits::operations = 0;
+    kept = view.retain();
+    CHECK(counting_traits::operations == 1);
+    CHECK(ptr.use_count() == 2);
+  }
+  CHECK(base::destroyed == 0);
+  CHECK(kept.use_count() == 1);
+  kept.reset();
+  CHECK(base::destroyed == 1);
+}
+
+TEST_CASE("borrowed_ptr converts like retain_ptr") {
+  sg14::retain_ptr<derived> ptr { new derived };
+  sg14::borrowed_ptr<derived> exact = ptr;
+  sg14::borrowed_ptr<base> upcast = ptr;
+  sg14::borrowed_ptr<base> from_view = exact;
+  CHECK(upcast == from_view);
+  CHECK(upcast.get() == ptr.get());
+  static_assert(std::is_trivially_copyable_v<sg14::borrowed_ptr<base>>);
+  static_assert(not std::is_convertible_v<derived*, sg14::borrowed_ptr<derived>>);
+
+  sg14::retain_ptr<base> retained = upcast.retain();
+  CHECK(ptr.use_count() == 2);
+}
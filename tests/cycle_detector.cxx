@@ -0,0 +1,78 @@
+#include "doctest.hpp"
+#include <sg14/cycle_detector.hpp>
+
+#include <sstream>
+
+namespace {
+
+struct vertex : sg14::atomic_reference_count<vertex>, sg14::tracked<vertex, true> {
+  sg14::retain_ptr<vertex> next;
+  sg14::retain_ptr<vertex> other;
+};
+
+struct opaque : sg14::reference_count<opaque>, sg14::tracked<opaque, true> {
+  sg14::retain_ptr<vertex> hidden;
+};
+
+struct untracked : sg14::reference_count<untracked>, sg14::tracked<untracked, false> { };
+
+} /* nameless namespace */
+
+template <>
+struct sg14::retain_traversal<vertex> {
+  template <class Visitor>
+  static void traverse (vertex const& object, Visitor& visit) {
+    visit(object.next);
+    visit(object.other);
+  }
+};
+
+static_assert(std::is_empty_v<sg14::tracked<untracked, false>>);
+
+TEST_CASE("acyclic graphs reachable from outside are not reported") {
+  auto base = sg14::tracked_object_count();
+  sg14::retain_ptr<vertex> root { new vertex };
+  root->next.reset(new vertex);
+  root->next->next.reset(new vertex);
+  root->other = root->next->next;
+  sg14::retain_ptr<untracked> ignored { new untracked };
+  REQUIRE(sg14::tracked_object_count() == base + 3);
+  REQUIRE(sg14::find_leaked_cycles().empty());
+}
+
+TEST_CASE("unreachable cycles are reported with their members") {
+  auto a = new vertex;
+  auto b = new vertex;
+  auto tail = new vertex;
+  {
+    sg14::retain_ptr<vertex> first { a };
+    first->next.reset(b);
+    first->next->next = first;
+    first->next->other.reset(tail);
+  }
+  sg14::retain_ptr<vertex> external { new vertex };
+  external->next = external;
+  REQUIRE(external.use_count() == 2);
+
+  auto cycles = sg14::find_leaked_cycles();
+  REQUIRE(cycles.size() == 1);
+  REQUIRE(cycles[0].objects.size() == 3);
+  REQUIRE(cycles[0].bytes == 3 * sizeof(vertex));
+  REQUIRE(cycles[0].objects[0].type.find("vertex") != std::string::npos);
+
+  std::ostringstream out;
+  REQUIRE(sg14::report_leaked_cycles(out) == 1);
+  REQUIRE(out.str().find("leaked cycle 0: 3 objects") == 0);
+
+  a->next = nullptr;
+  external->next = nullptr;
+  REQUIRE(sg14::find_leaked_cycles().empty());
+}
+
+TEST_CASE("objects without a traversal keep their targets alive") {
+  sg14::retain_ptr<opaque> holder { new opaque };
+  holder->hidden.reset(new vertex);
+  holder->hidden->next = holder->hidden;
+  REQUIRE(sg14::find_leaked_cycles().empty());
+  holder->hidden->next = nullptr;
+}
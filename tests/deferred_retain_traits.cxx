@@ -0,0 +1,120 @@
+#include "doctest.hpp"
+#include <sg14/memory.hpp>
+
+namespace {
+
+struct message : sg14::reference_count<message> {
+  static long destroyed;
+
+  using pointer = sg14::retain_ptr<message, sg14::deferred_retain_traits<message>>;
+
+  ~message () { ++destroyed; }
+
+  pointer next;
+};
+
+long message::destroyed = 0;
+
+using message_ptr = message::pointer;
+
+} /* nameless namespace */
+
+TEST_CASE("deferred releases wait for a flush") {
+  message::destroyed = 0;
+  {
+    message_ptr ptr { new message };
+    auto copy = ptr;
+    copy = nullptr;
+    REQUIRE(ptr.use_count() == 2);
+  }
+  REQUIRE(message::destroyed == 0);
+  sg14::flush_deferred_releases();
+  REQUIRE(message::destroyed == 1);
+}
+
+TEST_CASE("deferred releases of one object are coalesced") {
+  message::destroyed = 0;
+  message_ptr ptr { new message };
+  for (int i = 0; i < 1000; ++i) { auto copy = ptr; }
+  REQUIRE(ptr.use_count() == 1001);
+  REQUIRE(sg14::impl::release_buffer::local().pending() == 1);
+  sg14::flush_deferred_releases();
+  REQUIRE(ptr.use_count() == 1);
+  ptr = nullptr;
+  sg14::flush_deferred_releases();
+  REQUIRE(message::destroyed == 1);
+}
+
+TEST_CASE("releases deferred during a flush are flushed too") {
+  constexpr int length = 1000;
+  message::destroyed = 0;
+  {
+    message_ptr head { new message };
+    auto tail = head.get();
+    for (int i = 1; i < length; ++i) {
+      tail->next = message_ptr { new message };
+      tail = tail->next.get();
+    }
+  }
+  sg14::flush_deferred_releases();
+  REQUIRE(message::destroyed == length);
+}
+
+namespace {
+
+/* Counts the decrements that reach the underlying traits, optionally
+ * without a bulk form.
+ */
+template <bool Bulk>
+struct tallying_traits {
+  static inline long calls = 0;
+  static void increment (message* ptr) noexcept { sg14::retain_traits<message>::increment(ptr); }
+  static void decrement (message* ptr) noexcept {
+    ++calls;
+    sg14::retain_traits<message>::decrement(ptr);
+  }
+  template <bool B = Bulk, class = std::enable_if_t<B>>
+  static void decrement (message* ptr, std::size_t n) noexcept {
+    ++calls;
+    sg14::retain_traits<message>::decrement(ptr, n);
+  }
+  static long use_count (message* ptr) noexcept {
+    return sg14::retain_traits<message>::use_count(ptr);
+  }
+};
+
+} /* nameless namespace */
+
+TEST_CASE("a flush drops coalesced releases with one bulk decrement") {
+  using bulk_ptr = sg14::retain_ptr<message, sg14::deferred_retain_traits<message, tallying_traits<true>>>;
+  using single_ptr = sg14::retain_ptr<message, sg14::deferred_retain_traits<message, tallying_traits<false>>>;
+  message::destroyed = 0;
+  sg14::flush_deferred_releases();
+
+  bulk_ptr bulk { new message };
+  for (int i = 0; i < 100; ++i) { auto copy = bulk; }
+  sg14::flush_deferred_releases();
+  CHECK(tallying_traits<true>::calls == 1);
+  CHECK(bulk.use_count() == 1);
+
+  single_ptr single { new message };
+  for (int i = 0; i < 100; ++i) { auto copy = single; }
+  sg14::flush_deferred_releases();
+  CHECK(tallying_traits<false>::calls == 100);
+  CHECK(single.use_count() == 1);
+
+  bulk = nullptr;
+  single = nullptr;
+  sg14::flush_deferred_releases();
+  CHECK(message::destroyed == 2);
+}
+
+TEST_CASE("bulk releases report the last reference") {
+  message::destroyed = 0;
+  auto raw = new message;
+  sg14::retain_traits<message>::increment(raw, 4);
+  CHECK(not sg14::retain_traits<message>::release(raw, 3));
+  CHECK(sg14::retain_traits<message>::use_count(raw) == 2);
+  sg14::retain_traits<message>::decrement(raw, 2);
+  CHECK(message::destroyed == 1);
+}
@@ -0,0 +1,79 @@
+#include "doctest.hpp"
+#include <sg14/hazard_pointer.hpp>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct route : sg14::atomic_reference_count<route> {
+  static std::atomic<long> instances;
+
+  explicit route (long id) : id { id } { ++instances; }
+  ~route () { --instances; }
+
+  long id;
+};
+
+std::atomic<long> route::instances { 0 };
+
+using route_ptr = sg14::retain_ptr<route>;
+
+} /* nameless namespace */
+
+TEST_CASE("hazard_guard reads without touching the reference count") {
+  {
+    sg14::hazard_retain_ptr<route> slot { route_ptr { new route { 1 } } };
+    auto guard = slot.protect();
+    REQUIRE(guard->id == 1);
+    REQUIRE(guard.retain().use_count() == 2);
+    REQUIRE(guard.get()->id == 1);
+    auto owned = guard.retain();
+    REQUIRE(owned.use_count() == 2);
+  }
+  sg14::hazard_pointer_reclaim();
+  REQUIRE(route::instances == 0);
+}
+
+TEST_CASE("protected objects outlive their replacement") {
+  sg14::hazard_retain_ptr<route> slot { route_ptr { new route { 1 } } };
+  {
+    auto guard = slot.protect();
+    slot.store(route_ptr { new route { 2 } });
+    sg14::hazard_pointer_reclaim();
+    REQUIRE(route::instances == 2);
+    REQUIRE(guard->id == 1);
+  }
+  sg14::hazard_pointer_reclaim();
+  REQUIRE(route::instances == 1);
+
+  auto previous = slot.exchange(nullptr);
+  REQUIRE(previous->id == 2);
+  REQUIRE(not slot.protect());
+  previous = nullptr;
+  sg14::hazard_pointer_reclaim();
+  REQUIRE(route::instances == 0);
+}
+
+TEST_CASE("hazard_retain_ptr concurrent readers and writer") {
+  constexpr int iterations = 20000;
+  {
+    sg14::hazard_retain_ptr<route> slot { route_ptr { new route { 0 } } };
+    std::atomic<bool> failed { false };
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < 4; ++idx) {
+      threads.emplace_back([&, idx] {
+        for (int i = 0; i < iterations; ++i) {
+          if (idx == 0 and i % 16 == 0) { slot.store(route_ptr { new route { i } }); }
+          auto guard = slot.protect();
+          if (not guard or guard->id < 0) { failed = true; }
+          if (i % 64 == 0 and guard.retain().use_count() < 2) { failed = true; }
+        }
+      });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    REQUIRE(not failed);
+  }
+  sg14::hazard_pointer_reclaim();
+  REQUIRE(route::instances == 0);
+}
@@ -0,0 +1,170 @@
+#include "doctest.hpp"
+#include <sg14/instrumented.hpp>
+
+#include <iterator>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct session : sg14::atomic_reference_count<session> { };
+struct report : sg14::atomic_reference_count<report> { };
+struct untracked : sg14::reference_count<untracked> { };
+
+/* Counts its disposals and frees from a static buffer, so deleting the
+ * object instead of disposing of it through the traits would be caught.
+ */
+struct pooled : sg14::reference_count<pooled> {
+  static long disposals;
+};
+
+long pooled::disposals = 0;
+
+struct pooled_traits {
+  static void increment (pooled* ptr) noexcept { sg14::retain_traits<pooled>::increment(ptr); }
+  static bool release (pooled* ptr) noexcept { return sg14::retain_traits<pooled>::release(ptr); }
+  static void dispose (pooled* ptr) noexcept {
+    ptr->~pooled();
+    ++pooled::disposals;
+  }
+};
+
+/* Forwards only decrement, so final releases cannot be observed. */
+struct opaque_traits {
+  static void increment (untracked* ptr) noexcept { sg14::retain_traits<untracked>::increment(ptr); }
+  static void decrement (untracked* ptr) { sg14::retain_traits<untracked>::decrement(ptr); }
+};
+
+/* Retains raw pointers by default and counts its bulk increments. */
+struct ledger : sg14::atomic_reference_count<ledger> { };
+
+struct ledger_traits {
+  using default_action = sg14::retain_object_t;
+  static inline long bulk_increments = 0;
+  static void increment (ledger* ptr) noexcept { sg14::retain_traits<ledger>::increment(ptr); }
+  static void increment (ledger* ptr, std::size_t n) noexcept {
+    ++bulk_increments;
+    sg14::retain_traits<ledger>::increment(ptr, n);
+  }
+  static bool release (ledger* ptr) noexcept { return sg14::retain_traits<ledger>::release(ptr); }
+  static long use_count (ledger* ptr) noexcept { return sg14::retain_traits<ledger>::use_count(ptr); }
+};
+
+struct gadget : sg14::atomic_reference_count<gadget> { int value { 3 }; };
+
+using gadget_traits = sg14::allocated_retain_traits<gadget, std::allocator<gadget>>;
+
+template <class T>
+using instrumented = sg14::instrumented_retain_traits<T>;
+
+using session_ptr = sg14::retain_ptr<session, instrumented<session>>;
+using report_ptr = sg14::retain_ptr<report, instrumented<report>>;
+
+sg14::retain_statistics statistics_of (char const* name) {
+  for (auto& entry : sg14::retain_statistics_snapshot()) {
+    if (entry.type.find(name) != std::string::npos) { return entry; }
+  }
+  return { };
+}
+
+} /* nameless namespace */
+
+static_assert(std::is_same_v<
+  sg14::instrumentable_traits<untracked>,
+  sg14::retain_traits<untracked>
+>);
+static_assert(std::is_same_v<
+  sg14::instrumentable_traits<untracked, sg14::retain_traits<untracked>, true>,
+  sg14::instrumented_retain_traits<untracked>
+>);
+
+TEST_CASE("instrumented_retain_traits counts reference traffic per type") {
+  {
+    session_ptr ptr { new session };
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < 4; ++idx) {
+      threads.emplace_back([copy = ptr] {
+        for (int i = 0; i < 100; ++i) { auto local = copy; }
+      });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    auto copy = ptr;
+    REQUIRE(statistics_of("session").peak_use_count >= 2);
+  }
+  auto stats = statistics_of("session");
+  REQUIRE(stats.increments == 405);
+  REQUIRE(stats.decrements == 405 + 1);
+  REQUIRE(stats.releases == 1);
+}
+
+TEST_CASE("retain statistics can be dumped as a table or JSON") {
+  { report_ptr ptr { new report }; }
+  std::ostringstream table;
+  sg14::dump_retain_statistics(table);
+  REQUIRE(table.str().find("report\t0\t1\t1\t0\n") != std::string::npos);
+
+  std::ostringstream json;
+  sg14::dump_retain_statistics(json, sg14::statistics_format::json);
+  REQUIRE(json.str().find("{\"types\":[{\"type\":\"") == 0);
+  auto entry = json.str().find("report\"");
+  REQUIRE(entry != std::string::npos);
+  REQUIRE(json.str().find("\"releases\":1", entry) != std::string::npos);
+}
+
+TEST_CASE("instrumented_retain_traits disposes of objects through R") {
+  alignas(pooled) unsigned char storage[sizeof(pooled)];
+  {
+    sg14::retain_ptr<pooled, sg14::instrumented_retain_traits<pooled, pooled_traits>> ptr {
+      new (storage) pooled
+    };
+    auto copy = ptr;
+  }
+  REQUIRE(pooled::disposals == 1);
+  REQUIRE(statistics_of("pooled").releases == 1);
+}
+
+TEST_CASE("instrumented_retain_traits forwards decrement when R cannot report releases") {
+  { sg14::retain_ptr<untracked, sg14::instrumented_retain_traits<untracked, opaque_traits>> ptr { new untracked }; }
+  auto stats = statistics_of("untracked");
+  REQUIRE(stats.increments == 0);
+  REQUIRE(stats.decrements == 1);
+  REQUIRE(stats.releases == 0);
+}
+
+TEST_CASE("instrumented_retain_traits keeps the default action and bulk increments of R") {
+  using traits = sg14::instrumented_retain_traits<ledger, ledger_traits>;
+  static_assert(std::is_same_v<traits::default_action, sg14::retain_object_t>);
+  auto raw = new ledger;
+  {
+    sg14::retain_ptr<ledger, traits> ptr { raw };
+    REQUIRE(ptr.use_count() == 2);
+    std::vector<sg14::retain_ptr<ledger, traits>> copies;
+    ptr.clone_n(8, std::back_inserter(copies));
+    REQUIRE(ledger_traits::bulk_increments == 1);
+    REQUIRE(ptr.use_count() == 10);
+  }
+  auto stats = statistics_of("ledger");
+  REQUIRE(stats.increments == 1 + 8);
+  REQUIRE(stats.peak_use_count == 10);
+  REQUIRE(stats.releases == 0);
+  sg14::retain_ptr<ledger, traits> { raw, sg14::adopt_object };
+  REQUIRE(statistics_of("ledger").releases == 1);
+}
+
+TEST_CASE("instrumented_retain_traits keeps the pointer type of R") {
+  using traits = sg14::instrumented_retain_traits<gadget, gadget_traits>;
+  static_assert(std::is_same_v<traits::pointer, gadget_traits::pointer>);
+  auto allocated = sg14::allocate_retained<gadget>(std::allocator<gadget> { });
+  {
+    sg14::retain_ptr<gadget, traits> ptr { allocated.detach(), sg14::adopt_object };
+    auto copy = ptr;
+    REQUIRE(copy->value == 3);
+    REQUIRE(ptr.use_count() == 2);
+  }
+  auto stats = statistics_of("gadget");
+  REQUIRE(stats.increments == 1);
+  REQUIRE(stats.decrements == 2);
+}
@@ -0,0 +1,181 @@
+#include "doctest.hpp"
+#include <sg14/intrusive.hpp>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct ready;
+struct inbox;
+
+struct task :
+  sg14::atomic_reference_count<task>,
+  sg14::list_hook<ready>,
+  sg14::list_hook<>,
+  sg14::mpsc_hook<inbox>
+{
+  static inline std::atomic<int> destroyed { 0 };
+  explicit task (int value) noexcept : value { value } { }
+  ~task () { ++destroyed; }
+  int value;
+};
+
+/* Counts every reference count operation on a task. */
+struct counting_traits {
+  static inline std::atomic<long> operations { 0 };
+  static void increment (task* ptr) noexcept {
+    ++operations;
+    sg14::retain_traits<task>::increment(ptr);
+  }
+  static void decrement (task* ptr) noexcept {
+    ++operations;
+    sg14::retain_traits<task>::decrement(ptr);
+  }
+  static long use_count (task* ptr) noexcept {
+    return sg14::retain_traits<task>::use_count(ptr);
+  }
+};
+
+using task_ptr = sg14::retain_ptr<task, counting_traits>;
+
+} /* nameless namespace */
+
+TEST_CASE("retain_list links and unlinks without count traffic") {
+  task::destroyed = 0;
+  sg14::retain_list<task, ready, counting_traits> list;
+  std::vector<task_ptr> tasks;
+  for (int idx = 0; idx < 4; ++idx) { tasks.emplace_back(new task { idx }); }
+
+  counting_traits::operations = 0;
+  for (auto& item : tasks) { list.push_back(task_ptr { item.detach(), sg14::adopt_object }); }
+  CHECK(counting_traits::operations == 0);
+  CHECK(list.size() == 4);
+  CHECK(list.front()->value == 0);
+  CHECK(list.back()->value == 3);
+
+  int expected = 0;
+  for (auto& item : list) { CHECK(item.value == expected++); }
+
+  auto second = list.erase(&*std::next(list.begin()));
+  CHECK(second->value == 1);
+  CHECK(second.use_count() == 1);
+  list.push_front(std::move(second));
+  CHECK(list.front()->value == 1);
+
+  auto last = list.pop_back();
+  CHECK(last->value == 3);
+  CHECK(not static_cast<sg14::list_hook<ready>&>(*last).is_linked());
+  CHECK(counting_traits::operations == 0);
+
+  list.clear();
+  CHECK(list.empty());
+  CHECK(task::destroyed == 3);
+}
+
+TEST_CASE("retain_list inserts in front of a position without count traffic") {
+  task::destroyed = 0;
+  sg14::retain_list<task, ready, counting_traits> list;
+  list.push_back(task_ptr { new task { 0 } });
+  list.push_back(task_ptr { new task { 2 } });
+
+  counting_traits::operations = 0;
+  auto inserted = list.insert(std::next(list.begin()), task_ptr { new task { 1 } });
+  CHECK(inserted->value == 1);
+  list.insert(list.begin(), task_ptr { new task { -1 } });
+  list.insert(list.end(), task_ptr { new task { 3 } });
+  CHECK(counting_traits::operations == 0);
+
+  CHECK(list.size() == 5);
+  int expected = -1;
+  for (auto& item : list) { CHECK(item.value == expected++); }
+  CHECK(std::prev(list.end())->value == 3);
+
+  list.clear();
+  CHECK(task::destroyed == 5);
+}
+
+TEST_CASE("retain_list keeps an object on several lists at once") {
+  task::destroyed = 0;
+  sg14::retain_list<task, ready, counting_traits> ready_list;
+  sg14::retain_list<task, void, counting_traits> all;
+  {
+    task_ptr item { new task { 7 } };
+    ready_list.push_back(item);
+    all.push_back(std::move(item));
+  }
+  CHECK(ready_list.front() == all.front());
+  CHECK(counting_traits::use_count(all.front()) == 2);
+
+  auto moved = std::move(all);
+  CHECK(all.empty());
+  CHECK(moved.size() == 1);
+  all.splice(moved);
+  CHECK(moved.empty());
+  CHECK(all.size() == 1);
+
+  ready_list.clear();
+  CHECK(task::destroyed == 0);
+  all.clear();
+  CHECK(task::destroyed == 1);
+}
+
+TEST_CASE("retain_mpsc_queue is first in first out") {
+  task::destroyed = 0;
+  sg14::retain_mpsc_queue<task, inbox, counting_traits> queue;
+  CHECK(queue.empty());
+  CHECK(not queue.pop());
+
+  counting_traits::operations = 0;
+  for (int idx = 0; idx < 5; ++idx) { queue.push(task_ptr { new task { idx } }); }
+  CHECK(not queue.empty());
+  std::vector<task_ptr> popped;
+  for (int idx = 0; idx < 3; ++idx) { popped.push_back(queue.pop()); }
+  CHECK(counting_traits::operations == 0);
+  for (int idx = 0; idx < 3; ++idx) {
+    REQUIRE(popped[idx]);
+    CHECK(popped[idx]->value == idx);
+    CHECK(popped[idx].use_count() == 1);
+  }
+  popped.clear();
+  CHECK(task::destroyed == 3);
+}
+
+TEST_CASE("retain_mpsc_queue delivers every push from every producer") {
+  task::destroyed = 0;
+  constexpr int producers = 4;
+  constexpr int per_producer = 10000;
+  {
+    sg14::retain_mpsc_queue<task, inbox, counting_traits> queue;
+    std::vector<std::thread> threads;
+    for (int id = 0; id < producers; ++id) {
+      threads.emplace_back([&queue, id] {
+        for (int idx = 0; idx < per_producer; ++idx) {
+          queue.push(task_ptr { new task { id * per_producer + idx } });
+        }
+      });
+    }
+
+    std::vector<int> last(producers, -1);
+    bool ordered = true;
+    int received = 0;
+    while (received < producers * per_producer) {
+      auto item = queue.pop();
+      if (not item) {
+        std::this_thread::yield();
+        continue;
+      }
+      auto producer = item->value / per_producer;
+      ordered = ordered and item->value > last[producer];
+      last[producer] = item->value;
+      ++received;
+    }
+    for (auto& thread : threads) { thread.join(); }
+    CHECK(ordered);
+    CHECK(queue.empty());
+    CHECK(task::destroyed == producers * per_producer);
+
+    queue.push(task_ptr { new task { 0 } });
+  }
+  CHECK(task::destroyed == producers * per_producer + 1);
+}
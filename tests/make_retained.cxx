@@ -0,0 +1,126 @@
+#include "doctest.hpp"
+#include <sg14/memory.hpp>
+
+#include <string>
+
+namespace {
+
+struct counts {
+  long allocations = 0;
+  long deallocations = 0;
+};
+
+template <class T>
+struct counting_allocator {
+  using value_type = T;
+
+  explicit counting_allocator (counts* stats) noexcept : stats { stats } { }
+  template <class U>
+  counting_allocator (counting_allocator<U> const& that) noexcept :
+    stats { that.stats }
+  { }
+
+  T* allocate (std::size_t n) {
+    ++this->stats->allocations;
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate (T* ptr, std::size_t n) noexcept {
+    ++this->stats->deallocations;
+    std::allocator<T>().deallocate(ptr, n);
+  }
+
+  template <class U>
+  bool operator == (counting_allocator<U> const& that) const noexcept {
+    return this->stats == that.stats;
+  }
+  template <class U>
+  bool operator != (counting_allocator<U> const& that) const noexcept {
+    return this->stats != that.stats;
+  }
+
+  counts* stats;
+};
+
+struct widget : sg14::atomic_reference_count<widget> {
+  static long instances;
+
+  widget (std::string name, int size) : name { std::move(name) }, size { size } {
+    ++instances;
+  }
+  ~widget () { --instances; }
+
+  std::string name;
+  int size;
+};
+
+long widget::instances = 0;
+
+struct throwing : sg14::reference_count<throwing> {
+  throwing () { throw 42; }
+};
+
+} /* nameless namespace */
+
+TEST_CASE("make_retained") {
+  {
+    auto ptr = sg14::make_retained<widget>("gear", 3);
+    REQUIRE(ptr->name == "gear");
+    REQUIRE(ptr->size == 3);
+    REQUIRE(ptr.use_count() == 1);
+    REQUIRE(widget::instances == 1);
+  }
+  REQUIRE(widget::instances == 0);
+}
+
+TEST_CASE("allocate_retained releases through its allocator") {
+  counts stats;
+  {
+    auto ptr = sg14::allocate_retained<widget>(
+      counting_allocator<widget> { &stats },
+      "cog",
+      7);
+    REQUIRE(ptr->name == "cog");
+    REQUIRE(stats.allocations == 1);
+    {
+      auto copy = ptr;
+      REQUIRE(ptr.use_count() == 2);
+    }
+    REQUIRE(stats.deallocations == 0);
+  }
+  REQUIRE(widget::instances == 0);
+  REQUIRE(stats.deallocations == 1);
+}
+
+TEST_CASE("allocate_retained deallocates when construction throws") {
+  counts stats;
+  REQUIRE_THROWS(sg14::allocate_retained<throwing>(counting_allocator<int> { &stats }));
+  REQUIRE(stats.allocations == 1);
+  REQUIRE(stats.deallocations == 1);
+}
+
+TEST_CASE("allocate_retained results cannot be adopted with other traits") {
+  using allocated = decltype(sg14::allocate_retained<widget>(std::allocator<widget> { }, "", 0));
+  using pointer = allocated::pointer;
+  static_assert(not std::is_convertible_v<allocated, sg14::retain_ptr<widget>>);
+  static_assert(not std::is_constructible_v<sg14::retain_ptr<widget>, allocated>);
+  static_assert(not std::is_constructible_v<sg14::retain_ptr<widget>, pointer, sg14::retain_object_t>);
+  static_assert(not std::is_constructible_v<sg14::retain_ptr<widget>, pointer, sg14::adopt_object_t>);
+  static_assert(not std::is_constructible_v<sg14::borrowed_ptr<widget>, pointer>);
+  static_assert(not std::is_constructible_v<sg14::borrowed_ptr<widget>, allocated>);
+
+  auto ptr = sg14::allocate_retained<widget>(std::allocator<widget> { }, "allocated", 4);
+  auto copy = ptr;
+  REQUIRE(ptr == copy);
+  REQUIRE(ptr);
+  REQUIRE(ptr.get()->size == 4);
+  REQUIRE(std::hash<allocated> { }(ptr) == std::hash<widget*> { }(ptr.get().get()));
+  copy.reset();
+  REQUIRE(not copy);
+  REQUIRE(ptr.use_count() == 1);
+}
+
+TEST_CASE("allocate_retained with a stateless allocator adds no storage") {
+  using object = sg14::impl::allocated_object<widget, std::allocator<widget>>;
+  REQUIRE(sizeof(object) == sizeof(widget));
+}
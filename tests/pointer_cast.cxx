@@ -0,0 +1,110 @@
+#include "doctest.hpp"
+#include <sg14/memory.hpp>
+
+#include <vector>
+
+namespace {
+
+struct base : sg14::atomic_reference_count<base> {
+  virtual ~base () = default;
+};
+
+struct derived : base { int value = 3; };
+struct unrelated : base { };
+
+/* One traits type for the whole hierarchy, const or not, counting every
+ * operation.
+ */
+struct counting_traits {
+  static inline long operations = 0;
+  static void increment (base const* ptr) noexcept {
+    ++operations;
+    sg14::retain_traits<base>::increment(const_cast<base*>(ptr));
+  }
+  static void decrement (base const* ptr) noexcept {
+    ++operations;
+    sg14::retain_traits<base>::decrement(const_cast<base*>(ptr));
+  }
+  static long use_count (base const* ptr) noexcept {
+    return sg14::retain_traits<base>::use_count(const_cast<base*>(ptr));
+  }
+};
+
+} /* nameless namespace */
+
+static_assert(std::is_convertible_v<sg14::retain_ptr<derived>, sg14::retain_ptr<base>>);
+static_assert(not std::is_convertible_v<sg14::retain_ptr<base>, sg14::retain_ptr<derived>>);
+static_assert(not std::is_convertible_v<
+  sg14::retain_ptr<derived, counting_traits>,
+  sg14::retain_ptr<base>
+>);
+
+TEST_CASE("retain_ptr converts from derived to base") {
+  sg14::retain_ptr<derived> object { new derived };
+  sg14::retain_ptr<base> copy { object };
+  REQUIRE(object.use_count() == 2);
+  sg14::retain_ptr<base> moved { std::move(object) };
+  REQUIRE(not object);
+  REQUIRE(moved.use_count() == 2);
+  REQUIRE(moved == copy);
+}
+
+TEST_CASE("pointer casts rebind retain_traits") {
+  sg14::retain_ptr<base> object { new derived };
+  auto cast = sg14::static_pointer_cast<derived>(object);
+  static_assert(std::is_same_v<decltype(cast), sg14::retain_ptr<derived>>);
+  REQUIRE(cast->value == 3);
+  REQUIRE(object.use_count() == 2);
+  REQUIRE(not sg14::dynamic_pointer_cast<unrelated>(object));
+  REQUIRE(sg14::dynamic_pointer_cast<derived>(object) == cast);
+  REQUIRE(sg14::reinterpret_pointer_cast<derived>(object) == cast);
+}
+
+TEST_CASE("rvalue pointer casts transfer ownership without counting") {
+  using base_ptr = sg14::retain_ptr<base, counting_traits>;
+  counting_traits::operations = 0;
+  base_ptr object { new derived };
+
+  auto cast = sg14::static_pointer_cast<derived>(std::move(object));
+  static_assert(std::is_same_v<decltype(cast), sg14::retain_ptr<derived, counting_traits>>);
+  REQUIRE(not object);
+  REQUIRE(counting_traits::operations == 0);
+
+  base_ptr back { std::move(cast) };
+  auto failed = sg14::dynamic_pointer_cast<unrelated>(std::move(back));
+  REQUIRE(not failed);
+  REQUIRE(back);
+  auto again = sg14::dynamic_pointer_cast<derived>(std::move(back));
+  REQUIRE(not back);
+  REQUIRE(again->value == 3);
+  REQUIRE(counting_traits::operations == 0);
+
+  auto constant = sg14::const_pointer_cast<derived const>(std::move(again));
+  auto mutated = sg14::const_pointer_cast<derived>(std::move(constant));
+  mutated->value = 4;
+  REQUIRE(counting_traits::operations == 0);
+
+  auto copy = sg14::static_pointer_cast<base>(mutated);
+  REQUIRE(counting_traits::operations == 1);
+  REQUIRE(copy.use_count() == 2);
+}
+
+TEST_CASE("converting moves into base pointers do not count") {
+  using base_ptr = sg14::retain_ptr<base, counting_traits>;
+  using derived_ptr = sg14::retain_ptr<derived, counting_traits>;
+  counting_traits::operations = 0;
+  std::vector<base_ptr> bus;
+  for (int i = 0; i < 4; ++i) { bus.push_back(derived_ptr { new derived }); }
+  REQUIRE(counting_traits::operations == 0);
+
+  derived_ptr message { new derived };
+  bus[0] = std::move(message);
+  REQUIRE(not message);
+  REQUIRE(counting_traits::operations == 1);
+
+  derived_ptr shared { new derived };
+  bus[1] = shared;
+  REQUIRE(counting_traits::operations == 3);
+  REQUIRE(shared.use_count() == 2);
+  REQUIRE(bus[1] == sg14::static_pointer_cast<base>(shared));
+}
@@ -0,0 +1,84 @@
+#include "doctest.hpp"
+#include <sg14/rcu.hpp>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct route : sg14::atomic_reference_count<route> {
+  static std::atomic<long> instances;
+
+  explicit route (long id) : id { id } { ++instances; }
+  ~route () { --instances; }
+
+  long id;
+};
+
+std::atomic<long> route::instances { 0 };
+
+using route_ptr = sg14::retain_ptr<route>;
+
+} /* nameless namespace */
+
+TEST_CASE("retired objects outlive the read sections that may see them") {
+  sg14::rcu_domain domain;
+  sg14::rcu_retain_ptr<route> slot { route_ptr { new route { 1 } }, domain };
+  {
+    sg14::rcu_read_guard guard { domain };
+    auto current = slot.get(guard);
+    REQUIRE(sg14::retain_traits<route>::use_count(current) == 1);
+    slot.store(route_ptr { new route { 2 } });
+    {
+      sg14::rcu_read_guard nested { domain };
+      REQUIRE(slot.get(nested)->id == 2);
+    }
+    domain.reclaim();
+    REQUIRE(route::instances == 2);
+    REQUIRE(current->id == 1);
+  }
+  domain.reclaim();
+  REQUIRE(route::instances == 1);
+
+  auto previous = slot.exchange(nullptr);
+  REQUIRE(previous.use_count() == 2);
+  domain.synchronize();
+  REQUIRE(previous.use_count() == 1);
+  previous = nullptr;
+  REQUIRE(route::instances == 0);
+}
+
+TEST_CASE("rcu_domain releases pending objects when destroyed") {
+  {
+    sg14::rcu_domain domain;
+    sg14::rcu_read_guard guard { domain };
+    domain.retire(route_ptr { new route { 1 } });
+    domain.reclaim();
+    REQUIRE(route::instances == 1);
+  }
+  REQUIRE(route::instances == 0);
+}
+
+TEST_CASE("rcu_retain_ptr concurrent readers and writer") {
+  constexpr int iterations = 20000;
+  {
+    sg14::rcu_retain_ptr<route> slot { route_ptr { new route { 0 } } };
+    std::atomic<bool> failed { false };
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < 4; ++idx) {
+      threads.emplace_back([&, idx] {
+        for (int i = 0; i < iterations; ++i) {
+          if (idx == 0 and i % 16 == 0) { slot.store(route_ptr { new route { i } }); }
+          sg14::rcu_read_guard guard;
+          auto current = slot.get(guard);
+          if (not current or current->id < 0) { failed = true; }
+          if (i % 64 == 0 and slot.load().use_count() < 2) { failed = true; }
+        }
+      });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    REQUIRE(not failed);
+  }
+  sg14::rcu_domain::global().synchronize();
+  REQUIRE(route::instances == 0);
+}
@@ -0,0 +1,130 @@
+#include "doctest.hpp"
+#include <sg14/reclaimer.hpp>
+
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <vector>
+
+/* Counts every allocation made by the process. GCC pairs the inlined
+ * replacement functions with malloc and free and warns about the mismatch.
+ */
+#if defined(__GNUC__) and not defined(__clang__)
+  #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<long> allocations { 0 };
+
+void* operator new (std::size_t size) {
+  ++allocations;
+  if (auto ptr = std::malloc(size ? size : 1)) { return ptr; }
+  throw std::bad_alloc { };
+}
+
+void operator delete (void* ptr) noexcept { std::free(ptr); }
+void operator delete (void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+struct document : sg14::atomic_reference_count<document>, sg14::reclaim_hook {
+  static std::atomic<long> destroyed;
+  static std::atomic<bool> foreign;
+
+  ~document () {
+    foreign = foreign or std::this_thread::get_id() != owner;
+    ++destroyed;
+  }
+
+  std::thread::id owner = std::this_thread::get_id();
+};
+
+std::atomic<long> document::destroyed { 0 };
+std::atomic<bool> document::foreign { false };
+
+using document_ptr = sg14::retain_ptr<
+  document,
+  sg14::reclaiming_retain_traits<document>
+>;
+
+} /* nameless namespace */
+
+TEST_CASE("last references are destroyed by the background reclaimer") {
+  constexpr int count = 100;
+  document::destroyed = 0;
+  document::foreign = false;
+  {
+    std::vector<document_ptr> documents;
+    for (int i = 0; i < count; ++i) { documents.emplace_back(new document); }
+    auto copy = documents.front();
+    documents.clear();
+    sg14::background_reclaimer::drain();
+    REQUIRE(document::destroyed == count - 1);
+    REQUIRE(copy.use_count() == 1);
+  }
+  sg14::background_reclaimer::drain();
+  REQUIRE(document::destroyed == count);
+  REQUIRE(document::foreign);
+}
+
+TEST_CASE("inline_reclaimer disposes of objects immediately") {
+  using inline_ptr = sg14::retain_ptr<
+    document,
+    sg14::reclaiming_retain_traits<document, sg14::inline_reclaimer>
+  >;
+  document::destroyed = 0;
+  document::foreign = false;
+  inline_ptr { new document };
+  REQUIRE(document::destroyed == 1);
+  REQUIRE(not document::foreign);
+}
+
+static_assert(sg14::is_detected<
+  sg14::impl::has_bulk_increment,
+  sg14::reclaiming_retain_traits<document>,
+  document*
+>::value);
+
+TEST_CASE("clone_n takes references to reclaimed objects in bulk") {
+  using inline_ptr = sg14::retain_ptr<
+    document,
+    sg14::reclaiming_retain_traits<document, sg14::inline_reclaimer>
+  >;
+  document::destroyed = 0;
+  std::vector<inline_ptr> copies;
+  {
+    inline_ptr ptr { new document };
+    ptr.clone_n(16, std::back_inserter(copies));
+    REQUIRE(ptr.use_count() == 17);
+  }
+  copies.clear();
+  REQUIRE(document::destroyed == 1);
+}
+
+TEST_CASE("retiring an object allocates nothing") {
+  std::vector<document_ptr> documents;
+  for (int i = 0; i < 100; ++i) { documents.emplace_back(new document); }
+  sg14::background_reclaimer::drain();
+  document::destroyed = 0;
+  auto const before = allocations.load();
+  for (auto& item : documents) { item.reset(); }
+  auto const after = allocations.load();
+  sg14::background_reclaimer::drain();
+  CHECK(after == before);
+  CHECK(document::destroyed == 100);
+}
+
+TEST_CASE("a stopped reclaimer disposes of objects inline") {
+  document::destroyed = 0;
+  document::foreign = false;
+  sg14::background_reclaimer reclaimer;
+  auto dispose = [] (sg14::reclaim_hook* object) { delete static_cast<document*>(object); };
+  reclaimer.push(new document, dispose);
+  reclaimer.stop();
+  CHECK(document::destroyed == 1);
+  CHECK(document::foreign);
+
+  document::foreign = false;
+  reclaimer.push(new document, dispose);
+  CHECK(document::destroyed == 2);
+  CHECK(not document::foreign);
+}
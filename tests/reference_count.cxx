@@ -0,0 +1,546 @@
+#include "doctest.hpp"
+#include <sg14/memory.hpp>
+
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct shared : sg14::atomic_reference_count<shared> {
+  static std::atomic<long> destroyed;
+  ~shared () { ++destroyed; }
+};
+
+std::atomic<long> shared::destroyed { 0 };
+
+struct isolated : sg14::atomic_reference_count<isolated, sg14::padded> {
+  static std::atomic<long> destroyed;
+  ~isolated () { ++destroyed; }
+  int field { 42 };
+};
+
+std::atomic<long> isolated::destroyed { 0 };
+
+} /* nameless namespace */
+
+TEST_CASE("atomic_reference_count is released exactly once") {
+  constexpr int objects = 200;
+  constexpr int threads = 4;
+  shared::destroyed = 0;
+  for (int round = 0; round < objects; ++round) {
+    std::vector<sg14::retain_ptr<shared>> copies;
+    sg14::retain_ptr<shared> ptr { new shared };
+    for (int idx = 0; idx < threads; ++idx) { copies.push_back(ptr); }
+    ptr = nullptr;
+
+    std::vector<std::thread> pool;
+    for (auto& copy : copies) {
+      pool.emplace_back([copy = std::move(copy)] () mutable {
+        for (int i = 0; i < 100; ++i) {
+          auto local = copy;
+          local = nullptr;
+        }
+      });
+    }
+    for (auto& thread : pool) { thread.join(); }
+  }
+  REQUIRE(shared::destroyed == objects);
+}
+
+TEST_CASE("padded atomic_reference_count keeps the counter on its own line") {
+  static_assert(alignof(isolated) == sg14::padded::alignment);
+  {
+    sg14::retain_ptr<isolated> ptr { new isolated };
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ptr.get()) % sg14::padded::alignment == 0);
+    auto field = reinterpret_cast<char const*>(&ptr->field);
+    REQUIRE(field - reinterpret_cast<char const*>(ptr.get()) >= 64);
+    auto copy = ptr;
+    REQUIRE(ptr.use_count() == 2);
+    REQUIRE(copy->field == 42);
+  }
+  REQUIRE(isolated::destroyed == 1);
+}
+
+namespace {
+
+struct biased : sg14::biased_reference_count<biased> {
+  static std::atomic<long> destroyed;
+  ~biased () { ++destroyed; }
+};
+
+std::atomic<long> biased::destroyed { 0 };
+
+using biased_ptr = sg14::retain_ptr<biased>;
+
+} /* nameless namespace */
+
+TEST_CASE("biased_reference_count on the owning thread") {
+  biased::destroyed = 0;
+  {
+    biased_ptr ptr { new biased };
+    REQUIRE(ptr.use_count() == 1);
+    {
+      auto copy = ptr;
+      REQUIRE(ptr.use_count() == 2);
+    }
+    REQUIRE(ptr.use_count() == 1);
+  }
+  REQUIRE(biased::destroyed == 1);
+}
+
+TEST_CASE("biased_reference_count released by another thread") {
+  biased::destroyed = 0;
+  biased_ptr ptr { new biased };
+  auto copy = ptr;
+  std::thread { [copy = std::move(copy)] () mutable {
+    auto local = copy;
+    copy = nullptr;
+    local = nullptr;
+  } }.join();
+  REQUIRE(biased::destroyed == 0);
+  REQUIRE(ptr.use_count() == 1);
+  ptr = nullptr;
+  REQUIRE(biased::destroyed == 1);
+}
+
+TEST_CASE("biased_reference_count outliving its owner") {
+  biased::destroyed = 0;
+  biased_ptr escaped;
+  std::thread { [&] {
+    biased_ptr ptr { new biased };
+    escaped = ptr;
+  } }.join();
+  REQUIRE(biased::destroyed == 0);
+  escaped = nullptr;
+  REQUIRE(biased::destroyed == 1);
+}
+
+TEST_CASE("biased_reference_count queued for its owner") {
+  constexpr int threads = 4;
+  biased::destroyed = 0;
+  biased_ptr ptr { new biased };
+  std::vector<biased_ptr> copies(threads, ptr);
+  std::vector<std::thread> pool;
+  for (auto& copy : copies) {
+    pool.emplace_back([copy = std::move(copy)] () mutable {
+      for (int i = 0; i < 100; ++i) { auto local = copy; }
+      copy = nullptr;
+    });
+  }
+  for (auto& thread : pool) { thread.join(); }
+  REQUIRE(biased::destroyed == 0);
+  sg14::flush_biased_reference_counts();
+  REQUIRE(ptr.use_count() == 1);
+  ptr = nullptr;
+  REQUIRE(biased::destroyed == 1);
+}
+
+namespace {
+
+struct sentinel : sg14::atomic_reference_count<sentinel> {
+  static std::atomic<long> destroyed;
+  ~sentinel () { ++destroyed; }
+};
+
+std::atomic<long> sentinel::destroyed { 0 };
+
+struct singleton : sg14::atomic_reference_count<singleton, sg14::skip_immortal> { };
+
+struct constant : sg14::reference_count<constant> { int value { 7 }; };
+
+} /* nameless namespace */
+
+TEST_CASE("immortal objects are never destroyed") {
+  sentinel::destroyed = 0;
+  sentinel* raw = nullptr;
+  {
+    sg14::retain_ptr<sentinel> ptr { new sentinel };
+    REQUIRE(not sg14::is_immortal(ptr));
+    sg14::immortalize(ptr);
+    REQUIRE(sg14::is_immortal(ptr));
+    auto const count = ptr.use_count();
+
+    std::vector<std::thread> pool;
+    for (int idx = 0; idx < 4; ++idx) {
+      pool.emplace_back([ptr] {
+        for (int i = 0; i < 1000; ++i) {
+          auto local = ptr;
+          local = nullptr;
+        }
+      });
+    }
+    for (auto& thread : pool) { thread.join(); }
+    REQUIRE(ptr.use_count() == count);
+    raw = ptr.get();
+  }
+  REQUIRE(sentinel::destroyed == 0);
+  REQUIRE(sg14::retain_traits<sentinel>::is_immortal(raw));
+  delete raw;
+}
+
+TEST_CASE("skip_immortal leaves immortal counts untouched") {
+  sg14::retain_ptr<singleton> ptr { new singleton };
+  auto copy = ptr;
+  REQUIRE(ptr.use_count() == 2);
+  sg14::immortalize(ptr);
+  auto const count = ptr.use_count();
+  std::vector<sg14::retain_ptr<singleton>> copies(100, ptr);
+  REQUIRE(ptr.use_count() == count);
+  sg14::retain_traits<singleton>::increment(ptr.get(), 10);
+  REQUIRE(ptr.use_count() == count);
+  copies.clear();
+  copy.reset();
+  REQUIRE(ptr.use_count() == count);
+  delete ptr.detach();
+}
+
+TEST_CASE("skip_immortal counts are never written while threads copy") {
+  sg14::retain_ptr<singleton> ptr { new singleton };
+  sg14::immortalize(ptr);
+  auto const count = ptr.use_count();
+  std::atomic<bool> done { false };
+  std::atomic<bool> written { false };
+  std::vector<std::thread> pool;
+  for (int idx = 0; idx < 4; ++idx) {
+    pool.emplace_back([ptr] {
+      for (int i = 0; i < 1000; ++i) {
+        auto local = ptr;
+        local = nullptr;
+      }
+    });
+  }
+  std::thread watcher { [&] {
+    while (not done.load()) {
+      if (ptr.use_count() != count) { written = true; }
+    }
+  } };
+  for (auto& thread : pool) { thread.join(); }
+  done = true;
+  watcher.join();
+  REQUIRE(not written);
+  REQUIRE(ptr.use_count() == count);
+  delete ptr.detach();
+}
+
+TEST_CASE("immortal reference_count objects are shared read-only") {
+  sg14::retain_ptr<constant> ptr { new constant };
+  sg14::immortalize(ptr);
+  auto const count = ptr.use_count();
+  std::vector<std::thread> pool;
+  for (int idx = 0; idx < 4; ++idx) {
+    pool.emplace_back([&ptr] {
+      for (int i = 0; i < 1000; ++i) {
+        auto local = ptr;
+        if (local->value != 7) { std::abort(); }
+      }
+    });
+  }
+  for (auto& thread : pool) { thread.join(); }
+  REQUIRE(ptr.use_count() == count);
+  REQUIRE(not sg14::is_immortal(sg14::retain_ptr<constant> { }));
+  delete ptr.detach();
+}
+
+namespace {
+
+struct wide_node : sg14::reference_count<wide_node> {
+  std::uint32_t value { };
+  wide_node* next { };
+};
+
+struct narrow_node : sg14::reference_count<narrow_node, std::uint32_t> {
+  std::uint32_t value { };
+  narrow_node* next { };
+};
+
+struct atomic_narrow_node : sg14::atomic_reference_count<atomic_narrow_node, std::uint32_t> {
+  std::uint32_t value { };
+  atomic_narrow_node* next { };
+};
+
+struct tiny : sg14::atomic_reference_count<tiny, std::uint16_t, sg14::saturating> {
+  static inline int destroyed = 0;
+  ~tiny () { ++destroyed; }
+};
+
+struct tiny_local : sg14::reference_count<tiny_local, sg14::saturating, std::int16_t> { };
+
+struct padded_narrow :
+  sg14::atomic_reference_count<padded_narrow, sg14::checked, std::uint32_t, sg14::padded>
+{ int field { 5 }; };
+
+} /* nameless namespace */
+
+static_assert(sizeof(narrow_node) == 16);
+static_assert(sizeof(atomic_narrow_node) == 16);
+static_assert(sizeof(narrow_node) < sizeof(wide_node));
+static_assert(alignof(padded_narrow) == sg14::padded::alignment);
+
+TEST_CASE("narrow counts behave like long ones") {
+  sg14::retain_ptr<atomic_narrow_node> ptr { new atomic_narrow_node };
+  auto copy = ptr;
+  REQUIRE(ptr.use_count() == 2);
+  copy.reset();
+  REQUIRE(ptr.use_count() == 1);
+
+  sg14::retain_ptr<padded_narrow> padded { new padded_narrow };
+  auto other = padded;
+  REQUIRE(padded.use_count() == 2);
+  REQUIRE(other->field == 5);
+}
+
+TEST_CASE("saturated narrow counts leave the object immortal") {
+  tiny::destroyed = 0;
+  sg14::retain_ptr<tiny> ptr { new tiny };
+  std::vector<sg14::retain_ptr<tiny>> copies;
+  while (not sg14::is_immortal(ptr)) { copies.push_back(ptr); }
+  REQUIRE(copies.size() + 1 == 16383);
+  copies.clear();
+  copies.resize(100, ptr);
+  copies.clear();
+  REQUIRE(sg14::is_immortal(ptr));
+  auto raw = ptr.detach();
+  REQUIRE(tiny::destroyed == 0);
+  delete raw;
+
+  sg14::retain_ptr<tiny_local> local { new tiny_local };
+  std::vector<sg14::retain_ptr<tiny_local>> locals;
+  while (not sg14::is_immortal(local)) { locals.push_back(local); }
+  REQUIRE(locals.size() + 1 == 8191);
+  locals.clear();
+  REQUIRE(sg14::is_immortal(local));
+  delete local.detach();
+}
+
+namespace {
+
+struct hot : sg14::sharded_reference_count<hot, 4> {
+  static std::atomic<long> destroyed;
+  ~hot () { ++destroyed; }
+};
+
+std::atomic<long> hot::destroyed { 0 };
+
+using hot_ptr = sg14::retain_ptr<hot>;
+
+} /* nameless namespace */
+
+TEST_CASE("sharded_reference_count is only released after switching") {
+  hot::destroyed = 0;
+  hot* raw = nullptr;
+  {
+    hot_ptr ptr { new hot };
+    raw = ptr.get();
+    std::vector<hot_ptr> copies(10, ptr);
+    REQUIRE(ptr.use_count() == 11);
+    copies.clear();
+    REQUIRE(ptr.use_count() == 1);
+    REQUIRE(sg14::retain_traits<hot>::is_sharded(raw));
+  }
+  REQUIRE(hot::destroyed == 0);
+  REQUIRE(sg14::retain_traits<hot>::use_count(raw) == 0);
+
+  hot_ptr ptr { raw, sg14::retain_object };
+  auto copy = ptr;
+  sg14::switch_to_atomic(ptr);
+  REQUIRE(not sg14::retain_traits<hot>::is_sharded(raw));
+  REQUIRE(ptr.use_count() == 2);
+  ptr.reset();
+  REQUIRE(hot::destroyed == 0);
+  copy.reset();
+  REQUIRE(hot::destroyed == 1);
+}
+
+TEST_CASE("sharded releases between publishing and folding stay counted") {
+  /* One reference counted in `central` by construction, one in a slot. */
+  sg14::impl::sharded_count<4> count;
+  count.increment();
+  count.publish();
+  REQUIRE(not count.decrement());
+  REQUIRE(not count.sharded());
+  count.fold();
+  REQUIRE(count.use_count() == 1);
+  REQUIRE(count.decrement());
+}
+
+TEST_CASE("sharded_reference_count switches while other threads count") {
+  constexpr int rounds = 50;
+  constexpr int threads = 4;
+  hot::destroyed = 0;
+  for (int round = 0; round < rounds; ++round) {
+    hot_ptr ptr { new hot };
+    std::atomic<int> started { 0 };
+    std::vector<std::thread> pool;
+    for (int idx = 0; idx < threads; ++idx) {
+      pool.emplace_back([copy = ptr, &started] () mutable {
+        ++started;
+        for (int i = 0; i < 2000; ++i) {
+          auto local = copy;
+          local.reset();
+        }
+      });
+    }
+    while (started != threads) { std::this_thread::yield(); }
+    sg14::switch_to_atomic(ptr);
+    ptr.reset();
+    for (auto& thread : pool) { thread.join(); }
+    REQUIRE(hot::destroyed == round + 1);
+  }
+}
+
+namespace {
+
+/* Counts increment calls on a shared object, with and without a bulk form. */
+template <bool Bulk>
+struct tallying_traits {
+  static inline long calls = 0;
+  static void increment (shared* ptr) noexcept {
+    ++calls;
+    sg14::retain_traits<shared>::increment(ptr);
+  }
+  template <bool B = Bulk, class = std::enable_if_t<B>>
+  static void increment (shared* ptr, std::size_t n) noexcept {
+    ++calls;
+    sg14::retain_traits<shared>::increment(ptr, n);
+  }
+  static void decrement (shared* ptr) noexcept {
+    sg14::retain_traits<shared>::decrement(ptr);
+  }
+  static long use_count (shared* ptr) noexcept {
+    return sg14::retain_traits<shared>::use_count(ptr);
+  }
+};
+
+/* Output iterator whose assignment throws once `limit` copies are written. */
+struct failing_output {
+  using iterator_category = std::output_iterator_tag;
+  using value_type = void;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = void;
+
+  failing_output& operator * () noexcept { return *this; }
+  failing_output& operator ++ () noexcept { return *this; }
+  failing_output& operator = (sg14::retain_ptr<shared>&& ptr) {
+    if (this->written->size() == this->limit) { throw 42; }
+    this->written->push_back(std::move(ptr));
+    return *this;
+  }
+
+  std::vector<sg14::retain_ptr<shared>>* written;
+  std::size_t limit;
+};
+
+} /* nameless namespace */
+
+static_assert(sg14::is_detected<
+  sg14::impl::has_bulk_increment,
+  sg14::retain_traits<shared>,
+  shared*
+>::value);
+static_assert(sg14::is_detected<
+  sg14::impl::has_bulk_increment,
+  sg14::deferred_retain_traits<shared>,
+  shared*
+>::value);
+static_assert(not sg14::is_detected<
+  sg14::impl::has_bulk_increment,
+  tallying_traits<false>,
+  shared*
+>::value);
+
+TEST_CASE("clone_n takes every reference with one bulk increment") {
+  shared::destroyed = 0;
+  {
+    sg14::retain_ptr<shared, tallying_traits<true>> ptr { new shared };
+    std::vector<sg14::retain_ptr<shared, tallying_traits<true>>> copies;
+    ptr.clone_n(64, std::back_inserter(copies));
+    CHECK(tallying_traits<true>::calls == 1);
+    CHECK(copies.size() == 64);
+    CHECK(ptr.use_count() == 65);
+    for (auto& copy : copies) { CHECK(copy == ptr); }
+    ptr.clone_n(0, std::back_inserter(copies));
+    CHECK(tallying_traits<true>::calls == 1);
+  }
+  CHECK(shared::destroyed == 1);
+
+  sg14::retain_ptr<shared, tallying_traits<false>> ptr { new shared };
+  std::vector<sg14::retain_ptr<shared, tallying_traits<false>>> copies(8);
+  ptr.clone_n(8, copies.begin());
+  CHECK(tallying_traits<false>::calls == 8);
+  CHECK(ptr.use_count() == 9);
+
+  sg14::retain_ptr<shared> none;
+  std::vector<sg14::retain_ptr<shared>> nulls;
+  none.clone_n(3, std::back_inserter(nulls));
+  CHECK(nulls.size() == 3);
+  for (auto& item : nulls) { CHECK(not item); }
+}
+
+TEST_CASE("clone_n releases the references it could not hand out") {
+  shared::destroyed = 0;
+  sg14::retain_ptr<shared> ptr { new shared };
+  std::vector<sg14::retain_ptr<shared>> written;
+  CHECK_THROWS(ptr.clone_n(10, failing_output { &written, 4 }));
+  CHECK(written.size() == 4);
+  CHECK(ptr.use_count() == 5);
+  written.clear();
+  ptr.reset();
+  CHECK(shared::destroyed == 1);
+}
+
+TEST_CASE("bulk increments saturate narrow counts") {
+  sg14::retain_ptr<tiny> ptr { new tiny };
+  sg14::retain_traits<tiny>::increment(ptr.get(), 100);
+  CHECK(ptr.use_count() == 101);
+  sg14::retain_traits<tiny>::increment(ptr.get(), 1 << 20);
+  CHECK(sg14::is_immortal(ptr));
+  delete ptr.detach();
+
+  sg14::retain_ptr<tiny_local> local { new tiny_local };
+  sg14::retain_traits<tiny_local>::increment(local.get(), 1 << 20);
+  CHECK(sg14::is_immortal(local));
+  delete local.detach();
+}
+
+TEST_CASE("bulk increments on the other counting mixins") {
+  biased_ptr owned { new biased };
+  std::vector<biased_ptr> biased_copies;
+  owned.clone_n(5, std::back_inserter(biased_copies));
+  CHECK(owned.use_count() == 6);
+  std::thread([&] { owned.clone_n(3, std::back_inserter(biased_copies)); }).join();
+  CHECK(owned.use_count() == 9);
+  biased_copies.clear();
+  CHECK(owned.use_count() == 1);
+
+  hot_ptr sharded { new hot };
+  std::vector<hot_ptr> sharded_copies;
+  sharded.clone_n(7, std::back_inserter(sharded_copies));
+  CHECK(sharded.use_count() == 8);
+  sg14::switch_to_atomic(sharded);
+  CHECK(sharded.use_count() == 8);
+  sharded_copies.clear();
+  CHECK(sharded.use_count() == 1);
+}
+
+TEST_CASE("bulk releases on the atomic and sharded mixins") {
+  shared::destroyed = 0;
+  auto raw = new shared;
+  sg14::retain_traits<shared>::increment(raw, 9);
+  CHECK(not sg14::retain_traits<shared>::release(raw, 5));
+  CHECK(sg14::retain_traits<shared>::use_count(raw) == 5);
+  sg14::retain_traits<shared>::decrement(raw, 5);
+  CHECK(shared::destroyed == 1);
+
+  hot::destroyed = 0;
+  hot_ptr ptr { new hot };
+  sg14::retain_traits<hot>::increment(ptr.get(), 6);
+  CHECK(not sg14::retain_traits<hot>::release(ptr.get(), 6));
+  sg14::retain_traits<hot>::increment(ptr.get(), 3);
+  sg14::switch_to_atomic(ptr);
+  CHECK(not sg14::retain_traits<hot>::release(ptr.get(), 3));
+  CHECK(ptr.use_count() == 1);
+  ptr.reset();
+  CHECK(hot::destroyed == 1);
+}
@@ -0,0 +1,153 @@
+#include "doctest.hpp"
+#include <sg14/retain_map.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct object : sg14::reference_count<object> {
+  static inline int destroyed = 0;
+  ~object () { ++destroyed; }
+};
+
+using map_type = sg14::retain_map<object, std::string>;
+
+} /* nameless namespace */
+
+TEST_CASE("std::hash hashes retain_ptr by identity") {
+  sg14::retain_ptr<object> first { new object };
+  sg14::retain_ptr<object> second { new object };
+  std::unordered_map<sg14::retain_ptr<object>, int> map;
+  map[first] = 1;
+  map[second] = 2;
+  CHECK(std::hash<sg14::retain_ptr<object>> { }(first) == std::hash<object*> { }(first.get()));
+  CHECK(map.at(first) == 1);
+  CHECK(map.at(second) == 2);
+  CHECK(first.use_count() == 2);
+}
+
+TEST_CASE("retain_map lookups by raw pointer leave the count alone") {
+  object::destroyed = 0;
+  sg14::retain_ptr<object> key { new object };
+  map_type map;
+  auto inserted = map.try_emplace(key, "first");
+  CHECK(inserted.second);
+  CHECK(key.use_count() == 2);
+
+  auto found = map.find(key.get());
+  REQUIRE(found);
+  CHECK(*found == "first");
+  CHECK(map.contains(key));
+  CHECK(key.use_count() == 2);
+
+  CHECK(not map.try_emplace(key, "second").second);
+  CHECK(key.use_count() == 2);
+  map.insert_or_assign(key, "second");
+  CHECK(map[key] == "second");
+  CHECK(map.size() == 1);
+
+  CHECK(map.erase(key.get()) == 1);
+  CHECK(map.erase(key.get()) == 0);
+  CHECK(key.use_count() == 1);
+  CHECK(not map.find(key));
+  CHECK(object::destroyed == 0);
+}
+
+TEST_CASE("retain_map adopts moved keys only when it inserts them") {
+  object::destroyed = 0;
+  map_type map;
+  sg14::retain_ptr<object> key { new object };
+  auto copy = key;
+  CHECK(map.try_emplace(std::move(copy), "value").second);
+  CHECK(not copy);
+  CHECK(key.use_count() == 2);
+
+  copy = key;
+  CHECK(not map.try_emplace(std::move(copy), "other").second);
+  CHECK(copy);
+  CHECK(key.use_count() == 3);
+}
+
+TEST_CASE("retain_map keeps every entry across growth and erasure") {
+  object::destroyed = 0;
+  std::vector<sg14::retain_ptr<object>> keys;
+  for (int idx = 0; idx < 1000; ++idx) { keys.emplace_back(new object); }
+  {
+    sg14::retain_map<object, int> map;
+    for (int idx = 0; idx < 1000; ++idx) { map.try_emplace(keys[idx], idx); }
+    CHECK(map.size() == 1000);
+    CHECK(map.capacity() * 3 / 4 >= 1000);
+
+    for (int idx = 0; idx < 1000; idx += 2) { map.erase(keys[idx]); }
+    CHECK(map.size() == 500);
+    for (int idx = 0; idx < 1000; ++idx) {
+      auto found = map.find(keys[idx].get());
+      if (idx % 2) {
+        REQUIRE(found);
+        CHECK(*found == idx);
+      } else {
+        CHECK(not found);
+      }
+    }
+
+    std::size_t visited = 0;
+    for (auto [key, value] : map) {
+      CHECK(key.get() == keys[value].get());
+      ++visited;
+    }
+    CHECK(visited == 500);
+
+    auto copy = map;
+    CHECK(keys[1].use_count() == 3);
+    auto moved = std::move(copy);
+    CHECK(copy.empty());
+    CHECK(keys[1].use_count() == 3);
+  }
+  for (auto& key : keys) { CHECK(key.use_count() == 1); }
+  keys.clear();
+  CHECK(object::destroyed == 1000);
+}
+
+TEST_CASE("retain_map may grow from one of its own values") {
+  std::vector<sg14::retain_ptr<object>> keys;
+  map_type map;
+  keys.emplace_back(new object);
+  map.try_emplace(keys.front(), std::string(64, 'x'));
+  while (map.size() < map.capacity() - map.capacity() / 4) {
+    keys.emplace_back(new object);
+    map.try_emplace(keys.back(), "filler");
+  }
+  auto const capacity = map.capacity();
+  keys.emplace_back(new object);
+  map.try_emplace(keys.back(), *map.find(keys.front()));
+  CHECK(map.capacity() > capacity);
+  CHECK(*map.find(keys.back()) == std::string(64, 'x'));
+
+  keys.emplace_back(new object);
+  map.insert_or_assign(keys.back(), *map.find(keys.front()));
+  CHECK(*map.find(keys.back()) == std::string(64, 'x'));
+}
+
+TEST_CASE("retain_map is unchanged when a value throws while growing") {
+  struct fussy {
+    explicit fussy (bool fail) { if (fail) { throw 42; } }
+  };
+  std::vector<sg14::retain_ptr<object>> keys;
+  sg14::retain_map<object, fussy> map;
+  keys.emplace_back(new object);
+  map.try_emplace(keys.back(), false);
+  while (map.size() < map.capacity() - map.capacity() / 4) {
+    keys.emplace_back(new object);
+    map.try_emplace(keys.back(), false);
+  }
+  auto const capacity = map.capacity();
+  auto const size = map.size();
+  sg14::retain_ptr<object> extra { new object };
+  CHECK_THROWS(map.try_emplace(extra, true));
+  CHECK(map.capacity() == capacity);
+  CHECK(map.size() == size);
+  CHECK(extra.use_count() == 1);
+  for (auto& key : keys) { CHECK(map.contains(key)); }
+}
@@ -0,0 +1,102 @@
+#include "doctest.hpp"
+#include <sg14/retain_vector.hpp>
+
+#include <string>
+
+namespace {
+
+struct object : sg14::reference_count<object> {
+  static inline int destroyed = 0;
+  explicit object (int value) : value { value } { }
+  ~object () { ++destroyed; }
+  int value;
+};
+
+/* Keeps a pointer to itself, so it must never be moved by copying bytes. */
+struct anchored {
+  explicit anchored (int value) noexcept : value { value } { }
+  anchored (anchored&& that) noexcept : value { that.value } { }
+  bool valid () const noexcept { return this->self == this; }
+  anchored const* self { this };
+  int value;
+};
+
+} /* nameless namespace */
+
+static_assert(sg14::is_trivially_relocatable_v<sg14::retain_ptr<object>>);
+static_assert(sg14::is_trivially_relocatable_v<int*>);
+static_assert(not sg14::is_trivially_relocatable_v<anchored>);
+static_assert(std::is_nothrow_move_constructible_v<sg14::retain_vector<object>>);
+
+TEST_CASE("retain_vector growth keeps every reference") {
+  object::destroyed = 0;
+  sg14::retain_ptr<object> item { new object { 4 } };
+  {
+    sg14::retain_vector<object> items;
+    for (int idx = 0; idx < 1000; ++idx) { items.push_back(item); }
+    CHECK(items.size() == 1000);
+    CHECK(items.capacity() >= 1000);
+    CHECK(item.use_count() == 1001);
+    for (auto& ptr : items) { CHECK(ptr.get() == item.get()); }
+  }
+  CHECK(item.use_count() == 1);
+  CHECK(object::destroyed == 0);
+}
+
+TEST_CASE("retain_vector may grow from one of its own elements") {
+  object::destroyed = 0;
+  sg14::retain_vector<object> items;
+  items.emplace_back(new object { 1 });
+  while (items.size() != items.capacity()) { items.push_back(items.front()); }
+  items.push_back(items.front());
+  CHECK(items.back()->value == 1);
+  CHECK(items.front().use_count() == static_cast<long>(items.size()));
+  items.clear();
+  CHECK(object::destroyed == 1);
+}
+
+TEST_CASE("retain_vector erase releases the element and closes the gap") {
+  object::destroyed = 0;
+  sg14::retain_vector<object> items;
+  for (int idx = 0; idx < 5; ++idx) { items.emplace_back(new object { idx }); }
+  auto next = items.erase(items.begin() + 1);
+  CHECK(object::destroyed == 1);
+  CHECK(items.size() == 4);
+  CHECK((*next)->value == 2);
+  CHECK(items.back()->value == 4);
+  items.erase(items.end() - 1);
+  items.pop_back();
+  CHECK(object::destroyed == 3);
+  CHECK(items.size() == 2);
+}
+
+TEST_CASE("retain_vector copies retain and moves steal") {
+  sg14::retain_ptr<object> item { new object { 9 } };
+  sg14::retain_vector<object> items { item, item };
+  CHECK(item.use_count() == 3);
+  auto copy = items;
+  CHECK(item.use_count() == 5);
+  auto moved = std::move(items);
+  CHECK(items.empty());
+  CHECK(item.use_count() == 5);
+  copy = moved;
+  CHECK(item.use_count() == 5);
+  moved.shrink_to_fit();
+  CHECK(moved.capacity() == 2);
+  copy = sg14::retain_vector<object> { };
+  CHECK(item.use_count() == 3);
+}
+
+TEST_CASE("relocating_vector moves types that are not trivially relocatable") {
+  sg14::relocating_vector<anchored> items;
+  for (int idx = 0; idx < 100; ++idx) { items.emplace_back(idx); }
+  items.erase(items.begin());
+  for (int idx = 0; idx < 99; ++idx) {
+    CHECK(items[idx].valid());
+    CHECK(items[idx].value == idx + 1);
+  }
+
+  sg14::relocating_vector<std::string> strings;
+  for (int idx = 0; idx < 100; ++idx) { strings.push_back(std::to_string(idx)); }
+  CHECK(strings[42] == "42");
+}
@@ -0,0 +1,78 @@
+#include "doctest.hpp"
+#include <sg14/slab_pool.hpp>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct message : sg14::atomic_reference_count<message>, sg14::pooled {
+  static std::atomic<long> instances;
+
+  message () { ++instances; }
+  ~message () { --instances; }
+
+  char payload[40];
+};
+
+std::atomic<long> message::instances { 0 };
+
+struct alignas(128) aligned_message : sg14::atomic_reference_count<aligned_message> {
+  char payload[100];
+};
+
+} /* nameless namespace */
+
+TEST_CASE("slab_pool recycles blocks of a size class") {
+  auto first = sg14::slab_pool::allocate(24);
+  sg14::slab_pool::deallocate(first, 24);
+  auto second = sg14::slab_pool::allocate(32);
+  REQUIRE(first == second);
+  sg14::slab_pool::deallocate(second, 32);
+}
+
+TEST_CASE("slab_pool hands large requests to operator new") {
+  auto block = sg14::slab_pool::allocate(sg14::slab_pool::max_size + 1);
+  REQUIRE(block);
+  sg14::slab_pool::deallocate(block, sg14::slab_pool::max_size + 1);
+}
+
+TEST_CASE("pooled objects released on another thread return to their owner") {
+  constexpr int count = 10000;
+  std::vector<sg14::retain_ptr<message>> messages;
+  for (int i = 0; i < count; ++i) {
+    messages.push_back(sg14::make_retained<message>());
+  }
+  auto first = messages.front().get();
+  std::thread { [&] { messages.clear(); } }.join();
+  REQUIRE(message::instances == 0);
+
+  std::vector<sg14::retain_ptr<message>> reused;
+  bool recycled = false;
+  for (int i = 0; i < count; ++i) {
+    reused.push_back(sg14::make_retained<message>());
+    recycled = recycled or reused.back().get() == first;
+  }
+  REQUIRE(recycled);
+}
+
+TEST_CASE("slab_allocator works with allocate_retained") {
+  {
+    auto ptr = sg14::allocate_retained<message>(sg14::slab_allocator<message> { });
+    REQUIRE(message::instances == 1);
+  }
+  REQUIRE(message::instances == 0);
+}
+
+TEST_CASE("slab_allocator honours the alignment of over-aligned types") {
+  sg14::slab_allocator<aligned_message> alloc;
+  std::vector<aligned_message*> blocks;
+  for (int idx = 0; idx < 64; ++idx) { blocks.push_back(alloc.allocate(1)); }
+  for (auto block : blocks) {
+    CHECK(reinterpret_cast<std::uintptr_t>(block) % alignof(aligned_message) == 0);
+  }
+  for (auto block : blocks) { alloc.deallocate(block, 1); }
+
+  auto ptr = sg14::allocate_retained<aligned_message>(sg14::slab_allocator<aligned_message> { });
+  CHECK(reinterpret_cast<std::uintptr_t>(ptr.get().get()) % alignof(aligned_message) == 0);
+}
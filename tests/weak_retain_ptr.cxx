@@ -0,0 +1,119 @@
+#include "doctest.hpp"
+#include <sg14/memory.hpp>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct entry : sg14::weak_reference_count<entry> {
+  static int destroyed;
+  explicit entry (int value) : value { value } { }
+  ~entry () { ++destroyed; }
+  int value;
+};
+
+int entry::destroyed = 0;
+
+struct shape : sg14::atomic_weak_reference_count<shape> {
+  static std::atomic<int> destroyed;
+  virtual ~shape () { ++destroyed; }
+  virtual int sides () const = 0;
+};
+
+std::atomic<int> shape::destroyed { 0 };
+
+struct other_base { virtual ~other_base () = default; long padding = 0; };
+
+struct square final : other_base, shape {
+  int sides () const override { return 4; }
+};
+
+struct extra { long padding = 0; };
+
+/* entry sits at a non-zero offset and has no vtable to find the rest. */
+struct tagged : extra, entry {
+  tagged () : entry { 1 } { }
+};
+
+struct alignas(64) aligned : sg14::weak_reference_count<aligned> {
+  char data[8] { };
+};
+
+struct throwing : sg14::weak_reference_count<throwing> {
+  throwing () { throw 42; }
+};
+
+} /* nameless namespace */
+
+static_assert(std::is_convertible_v<sg14::retain_ptr<square>, sg14::retain_ptr<shape>>);
+static_assert(not std::is_convertible_v<sg14::retain_ptr<tagged>, sg14::retain_ptr<entry>>);
+static_assert(not std::is_convertible_v<
+  sg14::retain_ptr<tagged> const&,
+  sg14::borrowed_ptr<entry>
+>);
+static_assert(std::is_convertible_v<sg14::retain_ptr<entry>, sg14::retain_ptr<entry const>>);
+
+TEST_CASE("weak_retain_ptr locks until the last strong reference goes") {
+  entry::destroyed = 0;
+  sg14::weak_retain_ptr<entry> weak;
+  REQUIRE(weak.expired());
+  REQUIRE(not weak.lock());
+  {
+    sg14::retain_ptr<entry> strong { new entry { 7 } };
+    weak = strong;
+    REQUIRE(weak.use_count() == 1);
+    auto locked = weak.lock();
+    REQUIRE(locked == strong);
+    REQUIRE(strong.use_count() == 2);
+    REQUIRE(locked->value == 7);
+  }
+  REQUIRE(entry::destroyed == 1);
+  REQUIRE(weak.expired());
+  REQUIRE(not weak.lock());
+  auto copy = weak;
+  weak.reset();
+  REQUIRE(copy.use_count() == 0);
+}
+
+TEST_CASE("weak counts work through polymorphic bases") {
+  shape::destroyed = 0;
+  sg14::retain_ptr<shape> strong { new square };
+  sg14::weak_retain_ptr<shape> weak { strong };
+  REQUIRE(weak.lock()->sides() == 4);
+  strong = nullptr;
+  REQUIRE(shape::destroyed == 1);
+  REQUIRE(weak.expired());
+}
+
+TEST_CASE("over-aligned objects keep their alignment") {
+  sg14::retain_ptr<aligned> strong { new aligned };
+  REQUIRE(reinterpret_cast<std::uintptr_t>(strong.get()) % 64 == 0);
+  sg14::weak_retain_ptr<aligned> weak { strong };
+  strong = nullptr;
+  REQUIRE(weak.expired());
+}
+
+TEST_CASE("storage is returned when a constructor throws") {
+  REQUIRE_THROWS_AS(new throwing, int);
+}
+
+TEST_CASE("atomic weak_retain_ptr lock races with the last release") {
+  shape::destroyed = 0;
+  constexpr int rounds = 500;
+  std::atomic<bool> failed { false };
+  for (int round = 0; round < rounds; ++round) {
+    sg14::retain_ptr<shape> strong { new square };
+    sg14::weak_retain_ptr<shape> weak { strong };
+    std::thread locker { [weak, &failed] {
+      for (int i = 0; i < 50; ++i) {
+        auto locked = weak.lock();
+        if (locked and locked->sides() != 4) { failed = true; }
+      }
+    } };
+    strong = nullptr;
+    locker.join();
+  }
+  REQUIRE(not failed);
+  REQUIRE(shape::destroyed == rounds);
+}